@@ -0,0 +1,249 @@
+// Microbenchmarks for the widget state map, the ID hash and draw sorting.
+// Build with -DTEXGUI_BUILD_BENCH=ON and run texgui_bench from a release build.
+
+#include "texgui.h"
+#include "texgui_internal.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace TexGui;
+namespace stc = std::chrono;
+
+#define BENCH_ENTRIES 10000
+#define BENCH_DRAWS 10000
+
+static volatile uint64_t sink;
+
+// Runs f until at least 200ms have passed, and returns the best time of one run in nanoseconds
+template <typename F>
+static double bench(F&& f)
+{
+    double best = 1e30;
+    stc::nanoseconds total(0);
+    while (total < stc::milliseconds(200))
+    {
+        auto start = stc::steady_clock::now();
+        f();
+        stc::nanoseconds t = stc::steady_clock::now() - start;
+        total += t;
+        best = std::min(best, double(t.count()));
+    }
+    return best;
+}
+
+// IDMap without the value pages: values sit next to their keys and move on rehash.
+// Only here to show what the indirection that keeps references stable costs.
+template <typename V>
+struct FlatIDMap
+{
+    std::vector<TexGuiID> keys;
+    std::vector<uint8_t> used;
+    std::vector<V> values;
+    uint32_t count = 0;
+
+    inline uint32_t size() const { return count; }
+    inline uint32_t mask() const { return uint32_t(keys.size()) - 1; }
+
+    V* find(TexGuiID key)
+    {
+        if (count == 0) return nullptr;
+        for (uint32_t i = key & mask();; i = (i + 1) & mask())
+        {
+            if (!used[i]) return nullptr;
+            if (keys[i] == key) return &values[i];
+        }
+    }
+
+    V& operator[](TexGuiID key)
+    {
+        if (V* v = find(key)) return *v;
+        if ((count + 1) * 4 > keys.size() * 3)
+        {
+            FlatIDMap old = std::move(*this);
+            uint32_t capacity = old.keys.empty() ? 64 : uint32_t(old.keys.size()) * 2;
+            keys.assign(capacity, 0);
+            used.assign(capacity, 0);
+            values.assign(capacity, V());
+            count = 0;
+            for (uint32_t j = 0; j < old.keys.size(); j++)
+                if (old.used[j]) (*this)[old.keys[j]] = std::move(old.values[j]);
+        }
+        uint32_t i = key & mask();
+        while (used[i]) i = (i + 1) & mask();
+        keys[i] = key;
+        used[i] = 1;
+        count++;
+        return values[i];
+    }
+};
+
+template <typename V>
+static V* lookup(IDMap<V>& m, TexGuiID key) { return m.find(key); }
+template <typename V>
+static V* lookup(FlatIDMap<V>& m, TexGuiID key) { return m.find(key); }
+template <typename V>
+static V* lookup(std::unordered_map<TexGuiID, V>& m, TexGuiID key)
+{
+    auto it = m.find(key);
+    return it == m.end() ? nullptr : &it->second;
+}
+
+template <typename Map>
+static void benchMap(const char* name, const std::vector<TexGuiID>& ids, const std::vector<TexGuiID>& misses)
+{
+    double insert = bench([&] {
+        Map m;
+        for (TexGuiID id : ids) m[id];
+        sink = sink + uint64_t(m.size());
+    });
+
+    Map m;
+    for (TexGuiID id : ids) m[id];
+    // a frame looks up every widget's state once, in submission order
+    double hit = bench([&] {
+        uint64_t n = 0;
+        for (TexGuiID id : ids) n += lookup(m, id) != nullptr;
+        sink = sink + n;
+    });
+    double miss = bench([&] {
+        uint64_t n = 0;
+        for (TexGuiID id : misses) n += lookup(m, id) != nullptr;
+        sink = sink + n;
+    });
+
+    printf("  %-28s insert %7.1f ns   hit %6.1f ns   miss %6.1f ns\n", name,
+           insert / ids.size(), hit / ids.size(), miss / misses.size());
+}
+
+template <typename V>
+static void benchMaps(const char* value)
+{
+    std::vector<TexGuiID> ids, misses;
+    for (uint32_t i = 0; i < BENCH_ENTRIES; i++)
+    {
+        std::string label = "window###item" + std::to_string(i);
+        ids.push_back(ImHashStr(label.c_str(), 0, 0));
+        misses.push_back(ImHashStr(label.c_str(), 0, 1));
+    }
+
+    printf("%u entries, %s (%zu bytes), per operation:\n", BENCH_ENTRIES, value, sizeof(V));
+    benchMap<IDMap<V>>("IDMap", ids, misses);
+    benchMap<FlatIDMap<V>>("IDMap, values inline", ids, misses);
+    benchMap<std::unordered_map<TexGuiID, V>>("std::unordered_map", ids, misses);
+}
+
+static uint32_t hashTable(const char* str, TexGuiID seed) { return ImHashStrConst(str, seed); }
+static uint32_t hashDefault(const char* str, TexGuiID seed) { return ImHashStr(str, 0, seed); }
+
+static void benchHash()
+{
+    std::vector<std::string> labels;
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < BENCH_ENTRIES; i++)
+    {
+        labels.push_back(i % 2 ? "Button " + std::to_string(i) : "Settings###scroll panel " + std::to_string(i));
+        bytes += labels.back().size();
+    }
+
+    printf("ImHashStr, %u labels of %.1f bytes on average, per label:\n", BENCH_ENTRIES, double(bytes) / labels.size());
+    struct { const char* name; TexGuiID(*fn)(const char*, TexGuiID); } paths[] = {
+        {"table", hashTable},
+        {GHasHardwareCrc32 ? "hardware crc32" : "default (no hardware crc32)", hashDefault},
+    };
+    for (auto [name, fn] : paths)
+    {
+        double t = bench([&] {
+            uint32_t h = 0;
+            for (const std::string& s : labels) h += fn(s.c_str(), 0);
+            sink = sink + h;
+        });
+        printf("  %-28s %6.1f ns\n", name, t / labels.size());
+    }
+}
+
+// 40x25 grid of widgets, each a background quad from the atlas and a label on top from the font,
+// so every other draw changes texture and only a widget's own two draws overlap
+static void widgetDraws(RenderData& rd)
+{
+    rd.clear();
+    for (uint32_t i = 0; i < BENCH_DRAWS; i++)
+    {
+        uint32_t widget = (i / 2) % 1000;
+        uint32_t layer = (i / 2) / 1000;
+        float x = float(widget % 40) * 48 + layer * 4;
+        float y = float(widget / 40) * 40 + layer * 4;
+        bool label = i % 2;
+
+        RenderData::Quad q = {};
+        q.pos.x = label ? x + 4 : x;
+        q.pos.y = label ? y + 4 : y;
+        q.size.x = label ? 36 : 44;
+        q.size.y = label ? 16 : 24;
+        rd.quads.push_back(q);
+
+        RenderData::Command c = {};
+        c.type = RD_CMD_DrawQuads;
+        c.draw.count = 1;
+        c.draw.textureIndex = label ? 1 : 0;
+        c.draw.shading = label ? RD_SHADE_Msdf : RD_SHADE_Textured;
+        rd.commands.push_back(c);
+    }
+}
+
+// Draws with random textures and positions, most of them overlapping something before them
+static void randomDraws(RenderData& rd)
+{
+    rd.clear();
+    std::mt19937 rng(1);
+    for (uint32_t i = 0; i < BENCH_DRAWS; i++)
+    {
+        RenderData::Quad q = {};
+        q.pos.x = float(rng() % 1900);
+        q.pos.y = float(rng() % 1060);
+        q.size.x = float(8 + rng() % 64);
+        q.size.y = float(8 + rng() % 32);
+        rd.quads.push_back(q);
+
+        RenderData::Command c = {};
+        c.type = RD_CMD_DrawQuads;
+        c.draw.count = 1;
+        c.draw.textureIndex = rng() % 4;
+        c.draw.shading = RD_SHADE_Textured;
+        rd.commands.push_back(c);
+    }
+}
+
+static void benchSortDraws()
+{
+    printf("sortDraws, %u draws:\n", BENCH_DRAWS);
+    RenderData rd;
+    std::vector<RenderData::DrawRef> out;
+    struct { const char* name; void(*build)(RenderData&); } cases[] = {
+        {"widget grid", widgetDraws},
+        {"random overlapping", randomDraws},
+    };
+    for (auto [name, build] : cases)
+    {
+        build(rd);
+        double t = bench([&] { rd.sortDraws(out); });
+
+        uint32_t calls = 0;
+        for (uint32_t i = 0; i < out.size(); i++)
+            calls += i == 0 || !RenderData::canMerge(rd.commands[out[i - 1].command], rd.commands[out[i].command]);
+        printf("  %-28s %8.1f us   %u draw calls\n", name, t / 1000, calls);
+    }
+}
+
+int main()
+{
+    benchMaps<ScrollPanelState>("ScrollPanelState");
+    benchMaps<TexGuiWindow>("TexGuiWindow");
+    benchHash();
+    benchSortDraws();
+    return 0;
+}
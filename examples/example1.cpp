@@ -184,7 +184,7 @@ void main() {
                 .Image(TexGui::getTexture("lollipop"));
         }
 
-        copy.copy(data);
+        copy = data;
         TexGui::render(copy);
         data.clear();
 
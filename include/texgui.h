@@ -12,13 +12,16 @@
 #include <array>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <cstdint>
+#include <cfloat>
 #include <cassert>
 #include <unordered_map>
 #include <vector>
 #include <span>
 #include "texgui_math.hpp"
 #include "texgui_style.hpp"
+#include "texgui_hash.hpp"
 
 NAMESPACE_BEGIN(TexGui);
 
@@ -29,8 +32,6 @@ Texture* loadTexture(const char* name, const unsigned char* pixels, int width, i
 bool loadTexture(const char* path);
 void init();
 
-using TexGuiID = uint32_t;
-
 class RenderData;
 
 struct Texture;
@@ -38,8 +39,17 @@ struct Font;
 
 using LazyData = int64_t;
 
+// Decodes and loads an icon, returning its texture (or nullptr on failure).
+// Called on a background thread: load with loadTexture(name, pixels, ...), which defers the upload to clear().
 using LazyIconFunc = Texture*(*)(LazyData);
 
+// An icon that is only loaded the first time it is drawn, see Image(TGContainer*, LazyIcon, int)
+struct LazyIcon
+{
+    LazyIconFunc func;
+    LazyData data;
+};
+
 struct TGStr {
     const uint8_t* utf8;
     size_t len;
@@ -51,6 +61,20 @@ struct TGStr {
     */
 };
 
+// Widget ID hashed at compile time, e.g. Button(c, TG_ID("ok"), label).
+// It is combined with the window seed in a single mix rather than rehashed,
+// so it is not the same ID as passing the same string at runtime.
+struct TGID
+{
+    const char* str;
+    size_t len;
+    TexGuiID hash;
+
+    consteval TGID(const char* s) :
+        str(s), len(std::char_traits<char>::length(s)), hash(ImHashStrConst(s, 0)) {}
+};
+#define TG_ID(str) TexGui::TGID(str)
+
 using CharacterFilter = bool(*)(unsigned int c);
 struct TexGuiWindow;
 
@@ -59,10 +83,14 @@ struct IconSheet
     uint32_t glID;
     int32_t iw, ih; // Size of a single icon
     int32_t w, h;
+    // One view per icon, row-major, built by loadIcons and owned by the context
+    Texture* icons;
+    uint32_t columns, rows;
     Texture* getIcon(uint32_t x, uint32_t y);
 };
 
 struct TGContainer;
+// size containers, contiguous in memory
 struct TGContainerArray
 {
     TGContainer* data;
@@ -76,12 +104,15 @@ TGContainer* BeginTooltip(Math::fvec2 size, TooltipStyle* style = nullptr);
 void EndTooltip(TGContainer* c);
 
 TGContainer* Window(const char* id, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags = 0, TexGui::WindowStyle* style = nullptr);
+TGContainer* Window(TGID id, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags = 0, TexGui::WindowStyle* style = nullptr);
 bool         Button(TGContainer* container, const char* id, TGStr label, TexGui::ButtonStyle* style = nullptr);
+bool         Button(TGContainer* container, TGID id, TGStr label, TexGui::ButtonStyle* style = nullptr);
 TGContainer* Box(TGContainer* container, float xpos, float ypos, float width, float height, uint32_t flags = 0, TexGui::BoxStyle* style = nullptr);
 TGContainer* Box(TGContainer* container);
 bool         CheckBox(TGContainer* container, bool* val, TexGui::CheckBoxStyle* style = nullptr);
 void         RadioButton(TGContainer* container, uint32_t* selected, uint32_t id, TexGui::RadioButtonStyle* style = nullptr);
 TGContainer* BeginScrollPanel(TGContainer* container, const char* name, TexGui::ScrollPanelStyle* style = nullptr);
+TGContainer* BeginScrollPanel(TGContainer* container, TGID name, TexGui::ScrollPanelStyle* style = nullptr);
 void         EndScrollPanel(TGContainer* container);
 int          SliderInt(TGContainer* container, int* val, int minVal, int maxVal, TexGui::SliderStyle* style = nullptr);
 //void      Image(TGContainer* container, Texture* texture, int scale = -1);
@@ -104,6 +135,39 @@ TGContainer* Grid(TGContainer* container, GridStyle* style = nullptr);
 // Arranges children in a vertical stack.
 TGContainer* Stack(TGContainer* container, float padding = -1, TexGui::StackStyle* style = nullptr);
 
+// Skips the items of a long Stack or Grid that are outside its scissor (usually a scroll panel),
+// so only the visible ones have to be submitted:
+//     TGContainer* list = Stack(BeginScrollPanel(c, "items"));
+//     ListClipper clip(list, itemCount, rowHeight);
+//     for (int32_t i = clip.start; i < clip.end; i++) ...
+// Submitted items have to take up the size they were given. When the clipper goes out of scope,
+// the list is sized as if every item was submitted.
+struct ListClipper
+{
+    int32_t start = 0; // first visible item
+    int32_t end = 0; // one past the last visible item
+
+    // Stack with fixed height items
+    ListClipper(TGContainer* stack, int32_t itemCount, float itemHeight);
+    // Stack with variable height items. The prefix sum of the heights is cached per list,
+    // and only rebuilt when the item count or version changes.
+    ListClipper(TGContainer* stack, std::span<const float> itemHeights, uint32_t version = 0);
+    // Grid with fixed size cells
+    ListClipper(TGContainer* grid, int32_t itemCount, Math::fvec2 cellSize);
+    ~ListClipper();
+
+    ListClipper(const ListClipper&) = delete;
+    ListClipper& operator=(const ListClipper&) = delete;
+
+    TGContainer* list;
+    bool grid;
+    int32_t count;
+    int32_t columns;
+    float top;
+    float total;
+    Math::fvec2 cellSize;
+};
+
 void         ProgressBar(TGContainer* container, float percentage, const TexGui::ProgressBarStyle* style = nullptr);
 void         ProgressBarV(TGContainer* container, float percentage, const TexGui::ProgressBarStyle* style = nullptr);
 TGContainer* Node(TGContainer* container, float x, float y);
@@ -114,18 +178,51 @@ TGContainerArray Column(TGContainer* container, std::initializer_list<float> hei
 TGContainerArray Row(TGContainer* container, uint32_t widthCount, const float* pWidths, float height = 0, TexGui::RowStyle* style = nullptr);
 TGContainerArray Column(TGContainer* container, uint32_t heightCount, const float* pHeights, float width = 0, TexGui::ColumnStyle* style = nullptr);
 
+// Flex item for Row and Column. The item starts at Basis pixels and gets a share of the free space in proportion
+// to Grow, while staying within Min and Max. Items don't shrink below their basis.
+struct FlexItem
+{
+    float Basis = 0;
+    float Grow = 1;
+    float Min = 0;
+    float Max = FLT_MAX;
+};
+
+TGContainerArray Row(TGContainer* container, uint32_t itemCount, const FlexItem* pItems, float height = 0, TexGui::RowStyle* style = nullptr);
+TGContainerArray Column(TGContainer* container, uint32_t itemCount, const FlexItem* pItems, float width = 0, TexGui::ColumnStyle* style = nullptr);
+
 Math::fbox getBounds(TGContainer* c);
 
 // #TODO: Doesn't work for all widgets.
 Math::fbox getSize(TGContainer* c);
 void Image(TGContainer* c, Texture* texture, int scale = -1);
 void Image(TGContainer* c, Texture* texture, uint32_t colorOverride, int scale);
+// Draws the placeholder (or nothing) until the icon has been loaded in the background
+void Image(TGContainer* c, LazyIcon icon, int scale = -1);
 
 void newFrame();
 float getTextScale();
 void setTextScale(float scale);
 float getUiScale();
 void setUiScale(float scale);
+
+// Per-widget state (windows, text inputs, scroll panels, animations) that hasn't been used for this many frames
+// is freed, a little at a time, by clear(). 0 keeps it forever.
+void setWidgetStateLifetime(uint32_t frames);
+
+struct WidgetStateCounts
+{
+    uint32_t windows;
+    uint32_t textInputs;
+    uint32_t scrollPanels;
+    uint32_t animations;
+};
+// Current and peak number of per-widget state entries
+void getWidgetStateCounts(WidgetStateCounts* current, WidgetStateCounts* peak);
+// Drawn in place of a lazy icon that isn't loaded yet, nullptr draws nothing
+void setLazyIconPlaceholder(Texture* texture);
+// Lazy icons not drawn for this many frames are unloaded and freed on the GPU, 0 keeps them forever.
+void setLazyIconLifetime(uint32_t frames);
 void render(const RenderData& rs);
 RenderData* newRenderData();
 
@@ -140,6 +237,9 @@ void destroy();
 inline bool Button(TGContainer* container, const char* id, TexGui::ButtonStyle* style = nullptr) {
     return Button(container, id, {(const uint8_t*)id, strlen(id)}, style);    
 }
+inline bool Button(TGContainer* container, TGID id, TexGui::ButtonStyle* style = nullptr) {
+    return Button(container, id, {(const uint8_t*)id.str, id.len}, style);
+}
 
 struct Texture;
 
@@ -150,29 +250,63 @@ Texture* getTexture(const char* name);
 
 Font* getFont(const char* name);
 
+// Interned texture and font names. Look a name up once, after that getting the texture is an array index.
+// The default handle is invalid, and so is the handle of a name that hasn't been loaded.
+struct TextureHandle
+{
+    uint32_t index = 0;
+    explicit operator bool() const { return index != 0; }
+};
+
+struct FontHandle
+{
+    uint32_t index = 0;
+    explicit operator bool() const { return index != 0; }
+};
+
+TextureHandle getTextureHandle(std::string_view name);
+Texture* getTexture(TextureHandle handle);
+FontHandle getFontHandle(std::string_view name);
+Font* getFont(FontHandle handle);
+
 Math::ivec2 getTextureSize(Texture* tex);
 
 float computeTextWidth(const std::vector<uint32_t>& codepoints);
 
 struct TextInputState;
+// Fixed point steps per pixel in RenderData::CompactVertex
+#define TEXGUI_VERTEX_SUBPIXEL 4
+
 class RenderData
 {
 public:
     bool ordered = false;
     int32_t priority = -1;
-    std::vector<RenderData> children;
+    // Pooled by TexGui, valid until the next TexGui::clear(). A copy points at its own copies of them instead.
+    std::vector<RenderData*> children;
     uint32_t alphaModifier = 0x000000FF;
 
     RenderData()
     {
     }
 
+    // Deep copy, so the copy can be rendered after the pooled children are reused
     void operator=(const RenderData& other)
     {
         commands = other.commands;
-        children = other.children;
+        children.clear();
+        ownedChildren.clear();
+        // reserved up front, so children can point into it
+        ownedChildren.reserve(other.children.size());
+        for (const RenderData* child : other.children)
+        {
+            ownedChildren.push_back(*child);
+            children.push_back(&ownedChildren.back());
+        }
         vertices = other.vertices;
-        indices = other.indices;
+        compactVertices = other.compactVertices;
+        quads = other.quads;
+        clipRects = other.clipRects;
         ordered = other.ordered;
         priority = other.priority;
     }
@@ -181,8 +315,11 @@ public:
     {
         commands.swap(other.commands);
         children.swap(other.children);
+        ownedChildren.swap(other.ownedChildren);
         vertices.swap(other.vertices);
-        indices.swap(other.indices);
+        compactVertices.swap(other.compactVertices);
+        quads.swap(other.quads);
+        clipRects.swap(other.clipRects);
         std::swap(ordered, other.ordered);
         std::swap(priority, other.priority);
     }
@@ -213,11 +350,41 @@ public:
     void pushScissor(Math::fbox region);
     void popScissor();
 
+    // Adds an axis-aligned quad, as an instance or 4 vertices depending on the renderer.
+    // rect is in framebuffer pixels, uv in texels, uvScale is 1 / texture size.
+    // The quad is cut to the scissor (uvs included), or dropped if it is outside it.
+    void pushQuad(Math::fbox rect, Math::fbox uv, Math::fvec2 uvScale, uint32_t col);
+    void pushVertex(Math::fvec2 pos, Math::fvec2 uv, uint32_t col);
+    struct Command;
+    // Draws the quads added since the last draw, returns the command or nullptr if there were none
+    Command* addDraw(uint32_t textureIndex, Math::fvec2 uvScale = {0, 0}, RenderDataShading shading = RD_SHADE_Textured);
+    // For geometry that pushQuad can't cut: -1 if bounds is outside the scissor, 0 if it is entirely
+    // inside, otherwise the clipIndex for its draw.
+    int32_t clipIndex(const Math::fbox& bounds);
+
+    // A command to submit, and where its quads start: in quads, or in vertices / 4 for RD_CMD_Draw
+    struct DrawRef
+    {
+        uint32_t command;
+        uint32_t first;
+    };
+    // The commands in the order to submit them. A draw is moved back past the draws it doesn't overlap
+    // to join an earlier one it can be merged with, so overlapping draws still keep their order.
+    // The renderer uploads the geometry in this order so that merged draws are contiguous.
+    void sortDraws(std::vector<DrawRef>& out) const;
+    // Whether b can be drawn in the same call as a, when its quads follow a's
+    static bool canMerge(const Command& a, const Command& b);
+
     void clear() {
         commands.clear();
         children.clear();
+        ownedChildren.clear();
         vertices.clear();
-        indices.clear();
+        compactVertices.clear();
+        quads.clear();
+        clipRects.clear();
+        clipStack.clear();
+        pendingQuads = 0;
         ordered = false;
     }
 
@@ -227,7 +394,8 @@ public:
         union {
             struct
             {
-                uint32_t indexCount;
+                // quads, 4 vertices each for RD_CMD_Draw
+                uint32_t count;
                 uint32_t textureIndex;
                 float scaleX;
                 float scaleY;
@@ -235,6 +403,15 @@ public:
                 float translateY = -1.f;
                 float uvScaleX;
                 float uvScaleY;
+                // RD_CMD_DrawSlices: left, top, right, bottom insets in texels, and their size in pixels
+                float border[4];
+                float borderScale;
+                // clipRects[clipIndex - 1] is applied by the shaders, 0 for none
+                uint32_t clipIndex;
+                RenderDataShading shading;
+                // RD_SHADE_Msdf*: distance range in framebuffer pixels, and the outline colour
+                float pxRange;
+                uint32_t outlineColor;
             } draw;
             struct
             {
@@ -254,10 +431,48 @@ public:
         uint32_t col = 0xFFFFFFFF;
     };
 
+    // 12 byte Vertex, used instead when the renderer asks for it.
+    // pos and uv are fixed point with TEXGUI_VERTEX_SUBPIXEL steps per pixel/texel.
+    struct CompactVertex
+    {
+        int16_t pos[2];
+        uint16_t uv[2];
+        uint32_t col;
+    };
+
+    // One instance per quad, expanded in the vertex shader
+    struct Quad
+    {
+        Math::fvec2 pos;
+        Math::fvec2 size;
+        uint16_t uv[4]; // u0, v0, u1, v1 normalised to 0-65535
+        uint32_t col;
+    };
+
     // Renderable objects
     std::vector<Command> commands;
+    // Every 4 vertices are a quad, the renderer indexes them as 0 1 2, 1 2 3
     std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
+    std::vector<CompactVertex> compactVertices;
+    std::vector<Quad> quads;
+    // Scissors for draws that couldn't be clipped on the CPU, in framebuffer pixels
+    std::vector<Math::fbox> clipRects;
+
+private:
+    // Children of a copy, see operator=
+    std::vector<RenderData> ownedChildren;
+
+    // pushQuad without the clipping
+    void emitQuad(const Math::fbox& rect, const Math::fbox& uv, Math::fvec2 uvScale, uint32_t col);
+
+    // Scissors are applied on the CPU where possible, and only sent to the renderer when something needs them
+    struct Clip
+    {
+        Math::fbox rect; // framebuffer pixels, intersected with the parent scissor
+        uint32_t index; // into clipRects + 1, 0 until a draw needs it
+    };
+    std::vector<Clip> clipStack;
+    uint32_t pendingQuads = 0;
 };
 
 void setRenderData(RenderData* renderData);
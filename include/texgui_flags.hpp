@@ -60,10 +60,23 @@ enum RenderDataCommandTypeEnum : uint32_t
 {
     RD_CMD_None,
     RD_CMD_Draw,
+    RD_CMD_DrawQuads,
+    RD_CMD_DrawSlices, // one quad per 9-slice texture, cut up in the vertex shader
     RD_CMD_Scissor,
 };
 using RenderDataCommandType = uint32_t;
 
+// Fragment shader variant a draw needs, one pipeline each
+enum RenderDataShadingEnum : uint32_t
+{
+    RD_SHADE_Flat, // vertex colour only, the texture isn't sampled
+    RD_SHADE_Textured,
+    RD_SHADE_Msdf, // multi-channel signed distance field text
+    RD_SHADE_MsdfOutline, // MSDF text with an outline
+    RD_SHADE_Count,
+};
+using RenderDataShading = uint32_t;
+
 
 enum {
     INHERIT = 0
@@ -6,105 +6,42 @@
 #include "texgui_types.hpp"
 #include <queue>
 #include <mutex>
+#include <chrono>
 #include <unordered_map>
 #include <atomic>
 #include <stack>
 #include <vector>
+#include <memory>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <type_traits>
 
 NAMESPACE_BEGIN(TexGui);
 
 struct Style;
-inline std::mutex TGInputLock;
 
-// CRC32 needs a 1KB lookup table (not cache friendly)
-// Although the code to generate the table is simple and shorter than the table itself, using a const table allows us to easily:
-// - avoid an unnecessary branch/memory tap, - keep the ImHashXXX functions usable by static constructors, - make it thread-safe.
-inline const uint32_t GCrc32LookupTable[256] =
+enum WindowLayer : uint8_t
 {
-    // CRC32c table compatible with SSE 4.2 instructions
-    0x00000000,0xF26B8303,0xE13B70F7,0x1350F3F4,0xC79A971F,0x35F1141C,0x26A1E7E8,0xD4CA64EB,0x8AD958CF,0x78B2DBCC,0x6BE22838,0x9989AB3B,0x4D43CFD0,0xBF284CD3,0xAC78BF27,0x5E133C24,
-    0x105EC76F,0xE235446C,0xF165B798,0x030E349B,0xD7C45070,0x25AFD373,0x36FF2087,0xC494A384,0x9A879FA0,0x68EC1CA3,0x7BBCEF57,0x89D76C54,0x5D1D08BF,0xAF768BBC,0xBC267848,0x4E4DFB4B,
-    0x20BD8EDE,0xD2D60DDD,0xC186FE29,0x33ED7D2A,0xE72719C1,0x154C9AC2,0x061C6936,0xF477EA35,0xAA64D611,0x580F5512,0x4B5FA6E6,0xB93425E5,0x6DFE410E,0x9F95C20D,0x8CC531F9,0x7EAEB2FA,
-    0x30E349B1,0xC288CAB2,0xD1D83946,0x23B3BA45,0xF779DEAE,0x05125DAD,0x1642AE59,0xE4292D5A,0xBA3A117E,0x4851927D,0x5B016189,0xA96AE28A,0x7DA08661,0x8FCB0562,0x9C9BF696,0x6EF07595,
-    0x417B1DBC,0xB3109EBF,0xA0406D4B,0x522BEE48,0x86E18AA3,0x748A09A0,0x67DAFA54,0x95B17957,0xCBA24573,0x39C9C670,0x2A993584,0xD8F2B687,0x0C38D26C,0xFE53516F,0xED03A29B,0x1F682198,
-    0x5125DAD3,0xA34E59D0,0xB01EAA24,0x42752927,0x96BF4DCC,0x64D4CECF,0x77843D3B,0x85EFBE38,0xDBFC821C,0x2997011F,0x3AC7F2EB,0xC8AC71E8,0x1C661503,0xEE0D9600,0xFD5D65F4,0x0F36E6F7,
-    0x61C69362,0x93AD1061,0x80FDE395,0x72966096,0xA65C047D,0x5437877E,0x4767748A,0xB50CF789,0xEB1FCBAD,0x197448AE,0x0A24BB5A,0xF84F3859,0x2C855CB2,0xDEEEDFB1,0xCDBE2C45,0x3FD5AF46,
-    0x7198540D,0x83F3D70E,0x90A324FA,0x62C8A7F9,0xB602C312,0x44694011,0x5739B3E5,0xA55230E6,0xFB410CC2,0x092A8FC1,0x1A7A7C35,0xE811FF36,0x3CDB9BDD,0xCEB018DE,0xDDE0EB2A,0x2F8B6829,
-    0x82F63B78,0x709DB87B,0x63CD4B8F,0x91A6C88C,0x456CAC67,0xB7072F64,0xA457DC90,0x563C5F93,0x082F63B7,0xFA44E0B4,0xE9141340,0x1B7F9043,0xCFB5F4A8,0x3DDE77AB,0x2E8E845F,0xDCE5075C,
-    0x92A8FC17,0x60C37F14,0x73938CE0,0x81F80FE3,0x55326B08,0xA759E80B,0xB4091BFF,0x466298FC,0x1871A4D8,0xEA1A27DB,0xF94AD42F,0x0B21572C,0xDFEB33C7,0x2D80B0C4,0x3ED04330,0xCCBBC033,
-    0xA24BB5A6,0x502036A5,0x4370C551,0xB11B4652,0x65D122B9,0x97BAA1BA,0x84EA524E,0x7681D14D,0x2892ED69,0xDAF96E6A,0xC9A99D9E,0x3BC21E9D,0xEF087A76,0x1D63F975,0x0E330A81,0xFC588982,
-    0xB21572C9,0x407EF1CA,0x532E023E,0xA145813D,0x758FE5D6,0x87E466D5,0x94B49521,0x66DF1622,0x38CC2A06,0xCAA7A905,0xD9F75AF1,0x2B9CD9F2,0xFF56BD19,0x0D3D3E1A,0x1E6DCDEE,0xEC064EED,
-    0xC38D26C4,0x31E6A5C7,0x22B65633,0xD0DDD530,0x0417B1DB,0xF67C32D8,0xE52CC12C,0x1747422F,0x49547E0B,0xBB3FFD08,0xA86F0EFC,0x5A048DFF,0x8ECEE914,0x7CA56A17,0x6FF599E3,0x9D9E1AE0,
-    0xD3D3E1AB,0x21B862A8,0x32E8915C,0xC083125F,0x144976B4,0xE622F5B7,0xF5720643,0x07198540,0x590AB964,0xAB613A67,0xB831C993,0x4A5A4A90,0x9E902E7B,0x6CFBAD78,0x7FAB5E8C,0x8DC0DD8F,
-    0xE330A81A,0x115B2B19,0x020BD8ED,0xF0605BEE,0x24AA3F05,0xD6C1BC06,0xC5914FF2,0x37FACCF1,0x69E9F0D5,0x9B8273D6,0x88D28022,0x7AB90321,0xAE7367CA,0x5C18E4C9,0x4F48173D,0xBD23943E,
-    0xF36E6F75,0x0105EC76,0x12551F82,0xE03E9C81,0x34F4F86A,0xC69F7B69,0xD5CF889D,0x27A40B9E,0x79B737BA,0x8BDCB4B9,0x988C474D,0x6AE7C44E,0xBE2DA0A5,0x4C4623A6,0x5F16D052,0xAD7D5351
+    WINDOW_LAYER_Front, // FRONT flag
+    WINDOW_LAYER_Normal,
+    WINDOW_LAYER_Back, // BACK flag
+    WINDOW_LAYER_COUNT
 };
 
-// Known size hash
-// It is ok to call ImHashData on a string with known length but the ### operator won't be supported.
-// FIXME-OPT: Replace with e.g. FNV1a hash? CRC32 pretty much randomly access 1KB. Need to do proper measurements.
-inline TexGuiID ImHashData(const void* data_p, size_t data_size, TexGuiID seed)
-{
-    uint32_t crc = ~seed;
-    const unsigned char* data = (const unsigned char*)data_p;
-    const unsigned char *data_end = (const unsigned char*)data_p + data_size;
-    const uint32_t* crc32_lut = GCrc32LookupTable;
-    while (data < data_end)
-        crc = (crc >> 8) ^ crc32_lut[(crc & 0xFF) ^ *data++];
-    return ~crc;
-}
-
-// Zero-terminated string hash, with support for ### to reset back to seed value
-// We support a syntax of "label###id" where only "###id" is included in the hash, and only "label" gets displayed.
-// Because this syntax is rarely used we are optimizing for the common case.
-// - If we reach ### in the string we discard the hash so far and reset to the seed.
-// - We don't do 'current += 2; continue;' after handling ### to keep the code smaller/faster (measured ~10% diff in Debug build)
-// FIXME-OPT: Replace with e.g. FNV1a hash? CRC32 pretty much randomly access 1KB. Need to do proper measurements.
-inline TexGuiID ImHashStr(const char* data_p, size_t data_size, TexGuiID seed)
-{
-    seed = ~seed;
-    uint32_t crc = seed;
-    const unsigned char* data = (const unsigned char*)data_p;
-#ifndef IMGUI_ENABLE_SSE4_2_CRC
-    const uint32_t* crc32_lut = GCrc32LookupTable;
-#endif
-    if (data_size != 0)
-    {
-        while (data_size-- != 0)
-        {
-            unsigned char c = *data++;
-            if (c == '#' && data_size >= 2 && data[0] == '#' && data[1] == '#')
-                crc = seed;
-#ifndef IMGUI_ENABLE_SSE4_2_CRC
-            crc = (crc >> 8) ^ crc32_lut[(crc & 0xFF) ^ c];
-#else
-            crc = _mm_crc32_u8(crc, c);
-#endif
-        }
-    }
-    else
-    {
-        while (unsigned char c = *data++)
-        {
-            if (c == '#' && data[0] == '#' && data[1] == '#')
-                crc = seed;
-#ifndef IMGUI_ENABLE_SSE4_2_CRC
-            crc = (crc >> 8) ^ crc32_lut[(crc & 0xFF) ^ c];
-#else
-            crc = _mm_crc32_u8(crc, c);
-#endif
-        }
-    }
-    return ~crc;
-}
-
 struct TexGuiWindow
 {
     int id = 0;
     Math::fbox box;
 
+    // 0 is the front, FRONT windows are -1 and BACK windows are INT_MAX
     int32_t order = 0;
 
+    // Intrusive front-to-back list, see WindowZList
+    TexGuiWindow* zPrev = nullptr;
+    TexGuiWindow* zNext = nullptr;
+    WindowLayer layer = WINDOW_LAYER_Normal;
+
     uint32_t state = 0;
     bool moving = false;
     bool resizing = false;
@@ -121,6 +58,44 @@ struct TexGuiWindow
     {
         return ImHashStr(str, strlen(str), id);
     }
+
+    TexGuiID getID(TGID str)
+    {
+        return ImHashCombine(str.hash, id);
+    }
+};
+
+// Windows in front-to-back order, one list per layer.
+// Bringing a window to the front is O(1), and TexGui::clear() walks the lists once per frame
+// to number the windows and find which one is under the cursor.
+struct WindowZList
+{
+    TexGuiWindow* head[WINDOW_LAYER_COUNT] = {};
+
+    inline void unlink(TexGuiWindow* w)
+    {
+        if (w->zPrev) w->zPrev->zNext = w->zNext;
+        else if (head[w->layer] == w) head[w->layer] = w->zNext;
+        if (w->zNext) w->zNext->zPrev = w->zPrev;
+        w->zPrev = nullptr;
+        w->zNext = nullptr;
+    }
+
+    inline void pushFront(TexGuiWindow* w, WindowLayer layer)
+    {
+        w->layer = layer;
+        w->zPrev = nullptr;
+        w->zNext = head[layer];
+        if (head[layer]) head[layer]->zPrev = w;
+        head[layer] = w;
+    }
+
+    inline void bringToFront(TexGuiWindow* w, WindowLayer layer)
+    {
+        if (head[layer] == w) return;
+        unlink(w);
+        pushFront(w, layer);
+    }
 };
 
 struct TextInputState 
@@ -129,6 +104,12 @@ struct TextInputState
     int selection[2] = {-1, -1};
     bool selecting = false;
     ContainerState state;
+
+    // Prefix sum of glyph advances, glyphX[i] is the x offset of glyph i and glyphX[len] is the text width.
+    // Only rebuilt when the text changes, so mouse lookups are a binary search.
+    std::vector<float> glyphX;
+    int glyphSize = 0;
+    bool glyphXDirty = true;
 };
 
 struct ScrollPanelState
@@ -138,58 +119,225 @@ struct ScrollPanelState
     bool scrolling = false;
 };
 
-enum KeyState : int
+#define TEXGUI_MOUSE_BUTTON_COUNT 64
+
+// Key/button states packed as bitsets, one bit per key.
+// pressed, released and repeat are only set on the frame the transition happened, and dirty marks every key
+// touched since the last frame, so newFrame() only clears words that actually changed.
+template <uint32_t N>
+struct KeyBitset
 {
-    KEY_Off = 0,
-    KEY_Press = 0x0001,
-    KEY_Held = 0x0002,
-    KEY_Release = 0x0004,
-    KEY_Repeat = 0x0008,
+    static constexpr uint32_t WordCount = (N + 63) / 64;
+
+    uint64_t down[WordCount] = {};
+    uint64_t pressed[WordCount] = {};
+    uint64_t released[WordCount] = {};
+    uint64_t repeat[WordCount] = {};
+    uint64_t dirty[WordCount] = {};
+
+    static inline uint64_t bit(uint32_t i) { return uint64_t(1) << (i & 63); }
+
+    inline bool isDown(uint32_t i) const { return down[i >> 6] & bit(i); }
+    inline bool isPressed(uint32_t i) const { return pressed[i >> 6] & bit(i); }
+    inline bool isReleased(uint32_t i) const { return released[i >> 6] & bit(i); }
+    inline bool isRepeat(uint32_t i) const { return repeat[i >> 6] & bit(i); }
+    inline bool isPressedOrRepeat(uint32_t i) const { return (pressed[i >> 6] | repeat[i >> 6]) & bit(i); }
+    // Down, and wasn't pressed or repeated this frame
+    inline bool isHeld(uint32_t i) const { return (down[i >> 6] & ~dirty[i >> 6]) & bit(i); }
+
+    inline bool anyPressed() const
+    {
+        uint64_t any = 0;
+        for (uint32_t w = 0; w < WordCount; w++) any |= pressed[w];
+        return any;
+    }
+
+    inline bool anyDown() const
+    {
+        uint64_t any = 0;
+        for (uint32_t w = 0; w < WordCount; w++) any |= down[w];
+        return any;
+    }
+
+    inline void newFrame()
+    {
+        for (uint32_t w = 0; w < WordCount; w++)
+        {
+            if (!dirty[w]) continue;
+            pressed[w] = 0;
+            released[w] = 0;
+            repeat[w] = 0;
+            dirty[w] = 0;
+        }
+    }
+
+    // Returns false if the key already changed this frame, the caller should hold on to the event until the next one.
+    inline bool apply(uint32_t i, bool keyDown, bool keyRepeat)
+    {
+        uint32_t w = i >> 6;
+        uint64_t b = bit(i);
+        if (dirty[w] & b) return false;
+
+        if (keyDown && !(down[w] & b))
+        {
+            down[w] |= b;
+            pressed[w] |= b;
+        }
+        else if (keyDown && keyRepeat)
+            repeat[w] |= b;
+        else if (!keyDown && down[w] & b)
+        {
+            down[w] &= ~b;
+            released[w] |= b;
+        }
+        else
+            return true;
+
+        dirty[w] |= b;
+        return true;
+    }
 };
 
-#define TEXGUI_MOUSE_BUTTON_COUNT 64
-#define TEXGUI_TEXT_BUF_SIZE 1000000
-struct InputData {
-    int keyStates[TexGuiKey_NamedKey_COUNT];
-    int mouseStates[TEXGUI_MOUSE_BUTTON_COUNT];
-    int mods = 0;
+// Must be a power of two
+#define TEXGUI_INPUT_QUEUE_SIZE 4096
+#define TEXGUI_INPUT_EVENT_TEXT_SIZE 16
 
-    int& lmb = mouseStates[0];
+enum InputEventType : uint8_t
+{
+    INPUT_EVENT_Key,
+    INPUT_EVENT_MouseButton,
+    INPUT_EVENT_MouseMotion,
+    INPUT_EVENT_MouseWheel,
+    INPUT_EVENT_Text,
+};
 
-    Math::fvec2 cursorPos;
-    Math::fvec2 mouseRelativeMotion;
-    Math::fvec2 scroll;
-    Math::ivec2 scrollDiscrete;
+struct InputEvent
+{
+    InputEventType type;
+    // steady_clock nanoseconds, events newer than the start of the frame are left for the next one
+    int64_t timestamp;
+    union
+    {
+        struct
+        {
+            TexGuiKey key;
+            int mods;
+            bool down;
+            bool repeat;
+        } key;
+        struct
+        {
+            int button;
+            bool down;
+        } mouseButton;
+        struct
+        {
+            Math::fvec2 pos;
+            Math::fvec2 relative;
+        } motion;
+        Math::fvec2 wheel;
+        struct
+        {
+            // utf8, not null terminated. Long strings are split over multiple events.
+            char utf8[TEXGUI_INPUT_EVENT_TEXT_SIZE];
+            uint8_t len;
+        } text;
+    };
+};
+
+// Bounded single-producer/single-consumer ring of input events.
+// The backend pushes from whichever thread it polls events on, and updateInput() drains it once per frame.
+// Events are dropped if the ring is full.
+struct InputQueue
+{
+    static_assert((TEXGUI_INPUT_QUEUE_SIZE & (TEXGUI_INPUT_QUEUE_SIZE - 1)) == 0);
+
+    InputEvent events[TEXGUI_INPUT_QUEUE_SIZE];
+    alignas(64) std::atomic<uint32_t> head = 0; // only written by the producer
+    alignas(64) std::atomic<uint32_t> tail = 0; // only written by the consumer
+
+    inline bool push(const InputEvent& event)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == TEXGUI_INPUT_QUEUE_SIZE)
+            return false;
+        events[h & (TEXGUI_INPUT_QUEUE_SIZE - 1)] = event;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Returns nullptr if the queue is empty
+    inline const InputEvent* peek()
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return nullptr;
+        return &events[t & (TEXGUI_INPUT_QUEUE_SIZE - 1)];
+    }
+
+    inline void pop()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+inline int64_t inputTimestamp()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-    char text[TEXGUI_TEXT_BUF_SIZE];
+// Backend side of the input. Everything here is only touched by the thread submitting events,
+// the per frame key states live in the input frame built by updateInput().
+struct InputData {
+    InputQueue queue;
 
+    // Last cursor position, for backends that don't report relative motion
+    Math::fvec2 cursorPos;
     bool firstMouse = false;
 
-    inline void submitKey(TexGuiKey key, KeyState state)
+    inline void submitKey(TexGuiKey key, bool down, bool repeat, int mods)
     {
-        keyStates[key] = state;
+        InputEvent e = {.type = INPUT_EVENT_Key, .timestamp = inputTimestamp()};
+        e.key = {key, mods, down, repeat};
+        queue.push(e);
     }
 
-    inline int getKeyState(TexGuiKey key)
+    // button is 1-indexed
+    inline void submitMouseButton(int button, bool down)
     {
-        return keyStates[key];
+        InputEvent e = {.type = INPUT_EVENT_MouseButton, .timestamp = inputTimestamp()};
+        e.mouseButton = {button - 1, down};
+        queue.push(e);
     }
 
-    inline void submitMouseButton(int button, KeyState state)
+    inline void submitMouseMotion(Math::fvec2 pos, Math::fvec2 relative)
     {
-        mouseStates[button - 1] = state;
+        cursorPos = pos;
+        InputEvent e = {.type = INPUT_EVENT_MouseMotion, .timestamp = inputTimestamp()};
+        e.motion = {pos, relative};
+        queue.push(e);
     }
 
-    inline int getMouseButtonState(int button)
+    inline void submitScroll(Math::fvec2 scroll)
     {
-        return mouseStates[button];
+        InputEvent e = {.type = INPUT_EVENT_MouseWheel, .timestamp = inputTimestamp()};
+        e.wheel = scroll;
+        queue.push(e);
     }
 
-    InputData()
+    inline void submitText(const char* text)
     {
-        memset(keyStates, KEY_Off, sizeof(int)*(TexGuiKey_NamedKey_COUNT));
-        memset(mouseStates, KEY_Off, sizeof(int)*(TEXGUI_MOUSE_BUTTON_COUNT));
-        memset(text, 0, sizeof(char) * TEXGUI_TEXT_BUF_SIZE);
+        int64_t timestamp = inputTimestamp();
+        size_t len = strlen(text);
+        while (len > 0)
+        {
+            InputEvent e = {.type = INPUT_EVENT_Text, .timestamp = timestamp};
+            e.text.len = len < TEXGUI_INPUT_EVENT_TEXT_SIZE ? len : TEXGUI_INPUT_EVENT_TEXT_SIZE;
+            memcpy(e.text.utf8, text, e.text.len);
+            if (!queue.push(e)) break;
+            text += e.text.len;
+            len -= e.text.len;
+        }
     }
 };
 
@@ -207,6 +355,17 @@ struct TGContainer
     Texture* texture;
 
     void* scrollPanelState = nullptr;
+
+    // Layout: containers that size themselves from their children (Stack, Grid) measure into `measured`,
+    // and tell their parent once, at creation, using last frame's size from the layout cache.
+    TexGuiID layoutId;
+    uint32_t childCount;
+    Math::fvec2 measured;
+    // the size the parent last arranged this container with
+    Math::fvec2 arranged;
+    bool layoutCached;
+    TGContainer* nextMeasured;
+
     union
     {
         struct
@@ -283,6 +442,452 @@ struct Arranger
     ArrangerSubmitProc submit;
 };
 
+// Name -> T registry for textures and fonts, indexed by handle (index + 1, 0 is invalid).
+// Entries live in fixed pages that never move, so Texture*/Font* pointers and handles stay valid.
+// Lookups never lock: the name table is replaced by a bigger copy when it fills up, and old tables are only freed
+// with the registry. Inserts take a mutex, so textures can be loaded on worker threads. An entry is filled in by
+// intern's initializer before its handle is published, writing it after that is up to the loader.
+template <typename T>
+struct AssetRegistry
+{
+    static constexpr uint32_t PageSize = 256;
+    static constexpr uint32_t MaxPages = 1024;
+
+    struct Entry
+    {
+        T value;
+        std::string name;
+        uint32_t hash;
+    };
+
+    struct Table
+    {
+        uint32_t mask;
+        std::unique_ptr<std::atomic<uint32_t>[]> slots; // handles
+    };
+
+    std::atomic<Entry*> pages[MaxPages] = {};
+    std::atomic<uint32_t> count = 0;
+    std::atomic<Table*> table = nullptr;
+    std::vector<std::unique_ptr<Table>> tables; // the current table and the ones it replaced
+    std::mutex writeLock;
+
+    AssetRegistry() = default;
+    AssetRegistry(const AssetRegistry&) = delete;
+    ~AssetRegistry()
+    {
+        for (auto& page : pages)
+            delete[] page.load();
+    }
+
+    static inline uint32_t hashName(std::string_view name) { return ImHashData(name.data(), name.size(), 0); }
+
+    inline Entry& entry(uint32_t handle)
+    {
+        uint32_t index = handle - 1;
+        return pages[index / PageSize].load(std::memory_order_acquire)[index % PageSize];
+    }
+
+    inline T* get(uint32_t handle) { return handle ? &entry(handle).value : nullptr; }
+
+    uint32_t find(std::string_view name)
+    {
+        Table* t = table.load(std::memory_order_acquire);
+        if (!t) return 0;
+
+        uint32_t hash = hashName(name);
+        for (uint32_t i = hash & t->mask;; i = (i + 1) & t->mask)
+        {
+            uint32_t handle = t->slots[i].load(std::memory_order_acquire);
+            if (handle == 0) return 0;
+            Entry& e = entry(handle);
+            if (e.hash == hash && e.name == name) return handle;
+        }
+    }
+
+    inline bool contains(std::string_view name) { return find(name) != 0; }
+
+    // Adds a default constructed entry if the name isn't present
+    inline uint32_t intern(std::string_view name) { return intern(name, [](T&) {}); }
+
+    // Adds an entry if the name isn't present, and calls init on it before it is published, so other threads
+    // never find it half written. init isn't called if the name is already present.
+    template <typename Init>
+    uint32_t intern(std::string_view name, Init&& init)
+    {
+        if (uint32_t handle = find(name)) return handle;
+
+        std::lock_guard<std::mutex> lock(writeLock);
+        if (uint32_t handle = find(name)) return handle;
+
+        uint32_t index = count.load(std::memory_order_relaxed);
+        assert(index < PageSize * MaxPages);
+        if (index % PageSize == 0)
+            pages[index / PageSize].store(new Entry[PageSize], std::memory_order_release);
+
+        Entry& e = pages[index / PageSize].load(std::memory_order_relaxed)[index % PageSize];
+        e.name = name;
+        e.hash = hashName(name);
+        init(e.value);
+        count.store(index + 1, std::memory_order_release);
+
+        Table* t = table.load(std::memory_order_relaxed);
+        if (!t || (index + 1) * 2 > t->mask + 1)
+        {
+            uint32_t capacity = t ? (t->mask + 1) * 2 : 64;
+            auto& grown = tables.emplace_back(new Table{capacity - 1, std::unique_ptr<std::atomic<uint32_t>[]>(new std::atomic<uint32_t>[capacity])});
+            for (uint32_t i = 0; i < capacity; i++)
+                grown->slots[i].store(0, std::memory_order_relaxed);
+            t = grown.get();
+            for (uint32_t handle = 1; handle <= index; handle++)
+                insertSlot(t, handle);
+            insertSlot(t, index + 1);
+            table.store(t, std::memory_order_release);
+        }
+        else
+        {
+            insertSlot(t, index + 1);
+        }
+        return index + 1;
+    }
+
+    inline void insertSlot(Table* t, uint32_t handle)
+    {
+        uint32_t i = entry(handle).hash & t->mask;
+        while (t->slots[i].load(std::memory_order_relaxed) != 0) i = (i + 1) & t->mask;
+        t->slots[i].store(handle, std::memory_order_release);
+    }
+
+    inline T& operator[](std::string_view name) { return *get(intern(name)); }
+};
+
+// Per-frame bump allocator for transient UI data (containers, decoded text, formatted strings).
+// Chunks are kept for the lifetime of the context and never move, so pointers stay valid until the next
+// TexGui::clear(), which rewinds the arena in O(1). Only trivially destructible types, nothing is destroyed.
+struct FrameArena
+{
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t chunk = 0;
+    size_t offset = 0;
+
+    void* allocBytes(size_t size, size_t align)
+    {
+        for (; chunk < chunks.size(); chunk++, offset = 0)
+        {
+            uintptr_t base = uintptr_t(chunks[chunk].data.get());
+            size_t p = ((base + offset + align - 1) & ~uintptr_t(align - 1)) - base;
+            if (p + size <= chunks[chunk].size)
+            {
+                offset = p + size;
+                return chunks[chunk].data.get() + p;
+            }
+        }
+
+        // Bigger than a chunk gets a chunk of its own
+        size_t chunkSize = size + align > ChunkSize ? size + align : ChunkSize;
+        chunks.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[chunkSize]), chunkSize});
+        chunk = chunks.size() - 1;
+        offset = 0;
+        return allocBytes(size, align);
+    }
+
+    template <typename T>
+    inline T* alloc(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return (T*)allocBytes(sizeof(T) * (count ? count : 1), alignof(T));
+    }
+
+    // Value initialized, like emplace_back(). The count objects are contiguous.
+    template <typename T>
+    inline T* create(size_t count = 1)
+    {
+        T* p = alloc<T>(count);
+        for (size_t i = 0; i < count; i++)
+            new (p + i) T();
+        return p;
+    }
+
+    inline void reset()
+    {
+        chunk = 0;
+        offset = 0;
+    }
+};
+
+// Measured size of a Stack or Grid last frame, keyed by TGContainer::layoutId.
+// Only valid while the container gets the same width.
+struct LayoutCacheEntry
+{
+    float width;
+    Math::fvec2 size;
+};
+
+// Variable height ListClipper, keyed by the list's TGContainer::layoutId.
+// prefix[i] is the offset of item i in the stack, prefix[count] is the height of the whole list.
+struct ListClipperState
+{
+    std::vector<float> prefix;
+    uint32_t version = 0;
+    float padding = 0;
+};
+
+enum LazyIconStatus : uint8_t
+{
+    LAZY_ICON_Unloaded,
+    LAZY_ICON_Loading,
+    LAZY_ICON_Ready,
+    LAZY_ICON_Failed,
+};
+
+// Keyed by the hash of the LazyIcon's func and data. Icons whose hashes collide are chained behind the first one,
+// so they are found, aged and evicted together.
+struct LazyIconState
+{
+    LazyIcon icon = {}; // func is nullptr until the state is used
+    LazyIconStatus status = LAZY_ICON_Unloaded;
+    Texture* texture = nullptr;
+    std::unique_ptr<LazyIconState> next;
+};
+
+inline bool operator==(const LazyIcon& a, const LazyIcon& b) { return a.func == b.func && a.data == b.data; }
+
+// Runs LazyIconFuncs on a background thread. Results are picked up by clear().
+struct LazyIconLoader
+{
+    struct Request
+    {
+        TexGuiID key;
+        LazyIcon icon;
+    };
+    struct Result
+    {
+        TexGuiID key;
+        LazyIcon icon;
+        Texture* texture;
+    };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Request> requests;
+    std::vector<Result> results;
+    bool quit = false;
+
+    void push(const Request& req)
+    {
+        {
+            std::lock_guard lock(mutex);
+            if (!thread.joinable())
+                thread = std::thread(&LazyIconLoader::run, this);
+            requests.push_back(req);
+        }
+        cv.notify_one();
+    }
+
+    void run()
+    {
+        std::unique_lock lock(mutex);
+        while (true)
+        {
+            cv.wait(lock, [this] { return quit || !requests.empty(); });
+            if (quit) return;
+
+            Request req = requests.front();
+            requests.pop_front();
+
+            lock.unlock();
+            Texture* tex = req.icon.func(req.icon.data);
+            lock.lock();
+
+            results.push_back({req.key, req.icon, tex});
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(mutex);
+            quit = true;
+        }
+        cv.notify_one();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    ~LazyIconLoader() { stop(); }
+};
+
+// Texture loaded off the main thread, uploaded to the renderer in clear()
+struct PendingUpload
+{
+    Texture* texture;
+    std::vector<uint8_t> pixels;
+    int width, height;
+    bool evicted = false; // the lazy icon was evicted before its upload, so it isn't uploaded at all
+};
+
+// Slots each IDMap looks at per frame when freeing unused widget state
+#define TEXGUI_GC_STEPS 64
+
+// Open-addressing hash map for per-widget state, keyed by TexGuiID.
+// Keys are already hashes, so they index the table directly with linear probing, and erase shifts entries back
+// instead of leaving tombstones. Keys and value indices are flat arrays; values live in fixed-size pages that never
+// move, so references stay valid across inserts (containers keep pointers to windows and scroll panels all frame).
+template <typename V>
+struct IDMap
+{
+    static constexpr uint32_t PageSize = 64;
+
+    std::vector<TexGuiID> keys;
+    std::vector<uint32_t> slots; // value index + 1, 0 is empty
+    std::vector<std::unique_ptr<V[]>> pages;
+    std::vector<uint32_t> freeValues;
+    std::vector<uint64_t> lastUsed; // frame each value was last looked up, per value index
+    uint32_t count = 0;
+    uint32_t peak = 0;
+    uint32_t valueCount = 0;
+    uint32_t sweepPos = 0;
+    uint64_t frame = 0;
+
+    inline uint32_t size() const { return count; }
+    inline uint32_t mask() const { return uint32_t(keys.size()) - 1; }
+    inline V& value(uint32_t index) { return pages[index / PageSize][index % PageSize]; }
+
+    inline V* find(TexGuiID key)
+    {
+        if (count == 0) return nullptr;
+        for (uint32_t i = key & mask();; i = (i + 1) & mask())
+        {
+            if (slots[i] == 0) return nullptr;
+            if (keys[i] == key)
+            {
+                lastUsed[slots[i] - 1] = frame;
+                return &value(slots[i] - 1);
+            }
+        }
+    }
+
+    inline bool contains(TexGuiID key) { return find(key) != nullptr; }
+
+    // Inserts a default constructed value if the key isn't present
+    V& operator[](TexGuiID key)
+    {
+        if (V* v = find(key)) return *v;
+
+        if ((count + 1) * 4 > keys.size() * 3)
+            rehash(keys.empty() ? 64 : uint32_t(keys.size()) * 2);
+
+        uint32_t index;
+        if (!freeValues.empty())
+        {
+            index = freeValues.back();
+            freeValues.pop_back();
+        }
+        else
+        {
+            index = valueCount++;
+            if (index / PageSize >= pages.size())
+            {
+                pages.emplace_back(new V[PageSize]);
+                lastUsed.resize(pages.size() * PageSize);
+            }
+        }
+
+        uint32_t i = key & mask();
+        while (slots[i] != 0) i = (i + 1) & mask();
+        keys[i] = key;
+        slots[i] = index + 1;
+        lastUsed[index] = frame;
+        count++;
+        peak = count > peak ? count : peak;
+        return value(index);
+    }
+
+    void erase(TexGuiID key)
+    {
+        if (count == 0) return;
+        for (uint32_t i = key & mask();; i = (i + 1) & mask())
+        {
+            if (slots[i] == 0) return;
+            if (keys[i] == key) return eraseSlot(i);
+        }
+    }
+
+    // Looks at up to `steps` slots from where the last sweep stopped, and erases entries that haven't been
+    // looked up for more than `maxAge` frames. onErase is called with each entry before it is erased.
+    template <typename F>
+    void sweep(uint64_t maxAge, uint32_t steps, F&& onErase)
+    {
+        if (count == 0) return;
+        if (steps > keys.size()) steps = uint32_t(keys.size());
+        for (uint32_t n = 0; n < steps; n++)
+        {
+            uint32_t i = sweepPos & mask();
+            if (slots[i] != 0 && frame - lastUsed[slots[i] - 1] > maxAge)
+            {
+                // erasing can shift another entry into this slot, so look at it again
+                onErase(keys[i], value(slots[i] - 1));
+                eraseSlot(i);
+                continue;
+            }
+            sweepPos = (i + 1) & mask();
+        }
+    }
+
+    void eraseSlot(uint32_t i)
+    {
+        uint32_t index = slots[i] - 1;
+        value(index) = V();
+        freeValues.push_back(index);
+        count--;
+
+        // Backward shift: pull later entries of the probe run into the hole unless their home slot is after it
+        for (uint32_t j = i;;)
+        {
+            j = (j + 1) & mask();
+            if (slots[j] == 0) break;
+            uint32_t home = keys[j] & mask();
+            if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;
+            keys[i] = keys[j];
+            slots[i] = slots[j];
+            i = j;
+        }
+        slots[i] = 0;
+    }
+
+    template <typename F>
+    inline void forEach(F&& f)
+    {
+        for (uint32_t i = 0; i < slots.size(); i++)
+            if (slots[i] != 0) f(keys[i], value(slots[i] - 1));
+    }
+
+    void rehash(uint32_t capacity)
+    {
+        std::vector<TexGuiID> oldKeys = std::move(keys);
+        std::vector<uint32_t> oldSlots = std::move(slots);
+        keys.assign(capacity, 0);
+        slots.assign(capacity, 0);
+        for (uint32_t j = 0; j < oldSlots.size(); j++)
+        {
+            if (oldSlots[j] == 0) continue;
+            uint32_t i = oldKeys[j] & mask();
+            while (slots[i] != 0) i = (i + 1) & mask();
+            keys[i] = oldKeys[j];
+            slots[i] = oldSlots[j];
+        }
+    }
+};
+
 struct TexGuiContext
 {
     bool capturingMouse = false;
@@ -306,6 +911,11 @@ struct TexGuiContext
     uint32_t activeWindow;
     int activeWindowOrder;
 
+    WindowZList windowOrder;
+    int nextWindowId = 0;
+    // Front-most window that was under the cursor last frame
+    TexGuiWindow* cursorWindow = nullptr;
+
     float contentScale = 1.f;
     void* backendData = nullptr;
     struct {
@@ -314,33 +924,72 @@ struct TexGuiContext
         void (*framebufferSizeCallback)(int width, int height);
         void (*renderClean)();
         void (*newFrame)();
+        // Frees a texture made by createTexture once the GPU is done with it, the id may be reused
+        void (*destroyTexture)(uint32_t id);
     } rendererFns;
     void* rendererData = nullptr;
-
-    std::vector<TGContainer> containers;
+    // Set by the renderer if it draws RenderData::quads, otherwise quads are emitted as vertices
+    bool instancedQuads = false;
+    // Set by the renderer to get RenderData::compactVertices instead of vertices
+    bool compactVertices = false;
+
+    FrameArena frameArena;
+    std::deque<RenderData> renderDataPool;
+    size_t renderDataPoolUsed = 0;
     std::vector<Arranger> arrangers;
 
     RenderData* renderData;
-    std::unordered_map<TexGuiID, Animation> animations;
+    IDMap<Animation> animations;
     Animation tooltipAnimation;
-    std::unordered_map<TexGuiID, TexGuiWindow> windows;
-    std::unordered_map<TexGuiID, TextInputState> textInputs;
-    std::unordered_map<TexGuiID, ScrollPanelState> scrollPanels;
+    IDMap<TexGuiWindow> windows;
+    IDMap<TextInputState> textInputs;
+    IDMap<ScrollPanelState> scrollPanels;
+    IDMap<LayoutCacheEntry> layoutCache;
+    IDMap<ListClipperState> listClippers;
+    // Containers measured this frame, their sizes go into layoutCache in clear()
+    TGContainer* measuredContainers = nullptr;
+
+    uint64_t frame = 0;
+    // Per-widget state unused for this many frames is freed by clear(), 0 keeps it forever
+    uint32_t widgetStateLifetime = 3600;
 
     //#TODO: separate rasterized and msdf font atlases 
-    std::unordered_map<std::string, TexGui::Font> fonts;
-    std::unordered_map<std::string, TexGui::Texture> textures;
+    AssetRegistry<TexGui::Font> fonts;
+    AssetRegistry<TexGui::Texture> textures;
+    // Icon views for each IconSheet from loadIcons
+    std::vector<std::unique_ptr<Texture[]>> iconSheets;
+
+    std::thread::id mainThread;
+    std::mutex uploadMutex;
+    std::vector<PendingUpload> pendingUploads;
+
+    IDMap<LazyIconState> lazyIcons;
+    // Ready lazy icons showing each texture. Different icons can return the same texture, so it is only evicted
+    // once none of them show it.
+    std::unordered_map<Texture*, uint32_t> lazyIconTextureRefs;
+    Texture* lazyIconPlaceholder = nullptr;
+    uint32_t lazyIconLifetime = 600;
+    LazyIconLoader lazyIconLoader;
 
     std::vector<Style*> styleStack;
+    // BeginStyle() reuses these, so nested styles don't allocate once they have been used
+    std::deque<Style> stylePool;
+
+    // PushStyle() overrides: where each field is and its old value
+    struct StyleOverride
+    {
+        void* field;
+        uint32_t size;
+        uint32_t offset; // into styleOverrideData
+        bool ownsStyle; // started the copy of the default style it overrides
+    };
+    std::vector<StyleOverride> styleOverrides;
+    std::vector<uint8_t> styleOverrideData;
     Style* defaultStyle;
 
     InputData io;
     bool initialised = false;
 
-    std::vector<char> tempBuffer;
-
-    std::vector<uint16_t> codepoints;
-
     TGContainer baseContainer = {};
 };
 
@@ -82,6 +82,24 @@ struct box
         return !(size.width <= 0 || size.height <= 0);
     }
 
+    // Overlap of a and b, not valid if they don't overlap
+    static box intersect(const box& a, const box& b)
+    {
+        T x0 = a.pos.x > b.pos.x ? a.pos.x : b.pos.x;
+        T y0 = a.pos.y > b.pos.y ? a.pos.y : b.pos.y;
+        T x1 = a.pos.x + a.size.width < b.pos.x + b.size.width ? a.pos.x + a.size.width : b.pos.x + b.size.width;
+        T y1 = a.pos.y + a.size.height < b.pos.y + b.size.height ? a.pos.y + a.size.height : b.pos.y + b.size.height;
+        return {x0, y0, x1 - x0, y1 - y0};
+    }
+
+    // _box is entirely inside this box
+    bool encloses(const box& _box) const
+    {
+        return _box.pos.x >= pos.x && _box.pos.y >= pos.y &&
+               _box.pos.x + _box.size.width <= pos.x + size.width &&
+               _box.pos.y + _box.size.height <= pos.y + size.height;
+    }
+
     bool contains(const box& _box)
     {
         if (((_box.pos.x >= pos.x && _box.pos.x <= pos.x + size.width) ||
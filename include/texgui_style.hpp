@@ -5,6 +5,7 @@
 #include <texgui_flags.hpp>
 #include <string>
 #include <chrono>
+#include <type_traits>
 
 namespace TexGui {
 
@@ -153,6 +154,25 @@ struct Style {
 Style* BeginStyle();
 void EndStyle();
 
+// The style widgets currently use
+Style* getStyle();
+
+// offset is the field's byte offset in Style
+void pushStyleOverride(size_t offset, const void* value, size_t size);
+
+// Overrides a single field of the current style until the matching PopStyle(), e.g.
+//     PushStyle(&Style::Button, &ButtonStyle::Padding, {4, 4, 4, 4});
+// Only the old value of the field is kept, so this is much cheaper than BeginStyle() for small changes.
+// The default style is never changed: overriding it first starts a copy, which the matching PopStyle() ends.
+template <typename S, typename F>
+inline void PushStyle(S Style::* widget, F S::* field, const std::type_identity_t<F>& value)
+{
+    static_assert(std::is_trivially_copyable_v<F>);
+    Style* style = getStyle();
+    pushStyleOverride((char*)&((style->*widget).*field) - (char*)style, &value, sizeof(F));
+}
+void PopStyle(int count = 1);
+
 Style* getDefaultStyle();
 
 int setPixelSize(int px);
@@ -51,6 +51,10 @@ struct Font
     float pixelSize;
 
     Texture* atlasTexture;
+    // Distance range of an MSDF atlas in atlas pixels, 0 for a rasterized one
+    float msdfPxRange = 0;
+    // MSDF only, drawn around the glyphs if the alpha isn't 0
+    uint32_t outlineColor = 0;
 
     float ascent;
     float descent;
@@ -27,6 +27,9 @@ struct VulkanInitInfo
 
     // (Optional)
     VkPipelineCache                 PipelineCache;
+    // (Optional) Used if PipelineCache is VK_NULL_HANDLE: TexGui creates its own cache, loaded from this file
+    // if it was saved by the same driver and device, and saved back to it on destroy()
+    const char*                     PipelineCachePath;
     //uint32_t                        Subpass;
     // Render passes are not supported.
 
@@ -38,6 +41,14 @@ struct VulkanInitInfo
     bool                            UseDynamicRendering;
     VkPipelineRenderingCreateInfo PipelineRenderingCreateInfo;
 
+    // (Optional) Draw quads as 28 byte instances expanded in the vertex shader instead of 4 vertices + 6 indices
+    bool                            UseInstancedQuads;
+    // (Optional) Use 12 byte vertices (RenderData::CompactVertex) instead of 20 byte ones
+    bool                            UseCompactVertices;
+    // (Optional) Submit the draws of each layer with vkCmdDrawIndirect/vkCmdDrawIndexedIndirect, reading their parameters
+    // from a storage buffer instead of push constants. Needs the multiDrawIndirect and drawIndirectFirstInstance features enabled.
+    bool                            UseIndirectDraws;
+
     // (Optional) Allocation, Debugging
     VkAllocationCallbacks*    allocationCallbacks = nullptr;
     void                            (*CheckVkResultFn)(VkResult err) = nullptr;
@@ -5,12 +5,14 @@
 #include "texgui_types.hpp"
 #include <cassert>
 #include <cstring>
+#include <cfloat>
 #include <cmath>
 #include <mutex>
 #include <list>
 #include <filesystem>
 #include "stb_image.h"
 #include "texgui_internal.hpp"
+#include "util.h"
 #include <chrono>
 #include <numbers>
 #include <span>
@@ -32,6 +34,7 @@ void TexGui::init()
 {
     GTexGui = new TexGuiContext();
     GTexGui->defaultStyle = initDefaultStyle();
+    GTexGui->mainThread = std::this_thread::get_id();
 }
 
 void TexGui::newFrame()
@@ -59,6 +62,30 @@ float TexGui::getTextScale()
     return GTexGui->textScale;
 }
  
+void TexGui::setWidgetStateLifetime(uint32_t frames)
+{
+    GTexGui->widgetStateLifetime = frames;
+}
+
+void TexGui::setLazyIconPlaceholder(Texture* texture)
+{
+    GTexGui->lazyIconPlaceholder = texture;
+}
+
+void TexGui::setLazyIconLifetime(uint32_t frames)
+{
+    GTexGui->lazyIconLifetime = frames;
+}
+
+void TexGui::getWidgetStateCounts(WidgetStateCounts* current, WidgetStateCounts* peak)
+{
+    auto& g = *GTexGui;
+    if (current)
+        *current = {g.windows.size(), g.textInputs.size(), g.scrollPanels.size(), g.animations.size()};
+    if (peak)
+        *peak = {g.windows.peak, g.textInputs.peak, g.scrollPanels.peak, g.animations.peak};
+}
+ 
 RenderData* TexGui::newRenderData()
 {
     return new RenderData();
@@ -79,37 +106,63 @@ bool TexGui::isCapturingMouse()
 #define M_PI  3.14159265358979323846264  // from CRC
 #endif
 
+// Whole image of width x height, sliced in thirds
+static void initTexture(Texture& t, int width, int height)
+{
+    t.bounds.pos.x = 0;
+    t.bounds.pos.y = 0;
+    t.bounds.size.width = width;
+    t.bounds.size.height = height;
+
+    t.size.x = width;
+    t.size.y = height;
+
+    t.top = float(height)/3.f;
+    t.right = float(width)/3.f;
+    t.bottom = float(height)/3.f;
+    t.left = float(width)/3.f;
+}
+
+// Finds or adds the texture called name for an image of width x height. New textures are initialized before
+// other threads can find them. Returns nullptr if it already has an image of a different size.
+static Texture* internTexture(std::string_view name, int width, int height)
+{
+    auto& textures = GTexGui->textures;
+    bool added = false;
+    Texture* t = textures.get(textures.intern(name, [&](Texture& entry) {
+        initTexture(entry, width, height);
+        added = true;
+    }));
+    if (added)
+        return t;
+
+    if (t->id == uint32_t(-1))
+        initTexture(*t, width, height);
+    else if (t->bounds.size.width != width || t->bounds.size.height != height)
+        return nullptr;
+    return t;
+}
+
 // returns 0 on success
 // #TODO: remove hover, press etc. and put them in styles instead
 // assumes 4 bytes in stride
 Texture* TexGui::loadTexture(const char* name, const unsigned char* pixels, int width, int height)
 {
-    if (GTexGui->textures.contains(name) && GTexGui->textures[name].id > -1)
+    Texture* texture = internTexture(name, width, height);
+    if (!texture)
     {
-        if (GTexGui->textures[name].bounds.size.width != width || GTexGui->textures[name].bounds.size.height != height)
-        {
-            printf("Texture variant dimension mismatch: %s\n", name);
-            return nullptr;
-        }
+        printf("Texture variant dimension mismatch: %s\n", name);
+        return nullptr;
     }
-    else
-    {
-        Texture& t = GTexGui->textures[name];
-        t.bounds.pos.x = 0;
-        t.bounds.pos.y = 0;
-        t.bounds.size.width = width;
-        t.bounds.size.height = height;
-
-        t.size.x = width;
-        t.size.y = height;
 
-        t.top = float(height)/3.f;
-        t.right = float(width)/3.f;
-        t.bottom = float(height)/3.f;
-        t.left = float(width)/3.f;
+    Texture& t = *texture;
+    // Off the main thread (e.g. from a LazyIconFunc) the renderer can't be used, so upload in clear()
+    if (std::this_thread::get_id() != GTexGui->mainThread)
+    {
+        std::lock_guard lock(GTexGui->uploadMutex);
+        GTexGui->pendingUploads.push_back({&t, std::vector<uint8_t>(pixels, pixels + size_t(width) * height * 4), width, height});
+        return &t;
     }
-
-    Texture& t = GTexGui->textures[name];
     t.id = GTexGui->rendererFns.createTexture((void*)pixels, width, height);
     //t.name = name;
 
@@ -142,32 +195,15 @@ bool TexGui::loadTexture(const char* path)
         return 1;
     }
 
-    if (GTexGui->textures.contains(fstr) && GTexGui->textures[fstr].id > -1)
+    Texture* texture = internTexture(fstr, width, height);
+    if (!texture)
     {
-        if (GTexGui->textures[fstr].bounds.size.width != width || GTexGui->textures[fstr].bounds.size.height != height)
-        {
-            printf("Texture variant dimension mismatch: %s\n", pstr.c_str());
-            return 1;
-        }
-    }
-    else
-    {
-        Texture& t = GTexGui->textures[fstr];
-        t.bounds.pos.x = 0;
-        t.bounds.pos.y = 0;
-        t.bounds.size.width = width;
-        t.bounds.size.height = height;
-
-        t.size.x = width;
-        t.size.y = height;
-
-        t.top = float(height)/3.f;
-        t.right = float(width)/3.f;
-        t.bottom = float(height)/3.f;
-        t.left = float(width)/3.f;
+        printf("Texture variant dimension mismatch: %s\n", pstr.c_str());
+        stbi_image_free(pixels);
+        return 1;
     }
 
-    Texture& t = GTexGui->textures[fstr];
+    Texture& t = *texture;
 
     if (pstr.ends_with(".hover.png"))
         t.hover = GTexGui->rendererFns.createTexture(pixels, width, height);
@@ -215,32 +251,15 @@ void TexGui::loadTextures(const char* dir)
             continue;
         }
 
-        if (GTexGui->textures.contains(fstr) && GTexGui->textures[fstr].id > -1)
-        {
-            if (GTexGui->textures[fstr].bounds.size.width != width || GTexGui->textures[fstr].bounds.size.height != height)
-            {
-                printf("Texture variant dimension mismatch: %s\n", pstr.c_str());
-                continue;
-            }
-        }
-        else
+        Texture* texture = internTexture(fstr, width, height);
+        if (!texture)
         {
-            Texture& t = GTexGui->textures[fstr];
-            t.bounds.pos.x = 0;
-            t.bounds.pos.y = 0;
-            t.bounds.size.width = width;
-            t.bounds.size.height = height;
-
-            t.size.x = width;
-            t.size.y = height;
-
-            t.top = float(height)/3.f;
-            t.right = float(width)/3.f;
-            t.bottom = float(height)/3.f;
-            t.left = float(width)/3.f;
+            printf("Texture variant dimension mismatch: %s\n", pstr.c_str());
+            stbi_image_free(pixels);
+            continue;
         }
 
-        Texture& t = GTexGui->textures[fstr];
+        Texture& t = *texture;
 
         if (pstr.ends_with(".hover.png"))
             t.hover = GTexGui->rendererFns.createTexture(pixels, width, height);
@@ -267,7 +286,19 @@ IconSheet TexGui::loadIcons(const char* dir, int32_t iconWidth, int32_t iconHeig
     uint32_t texID = GTexGui->rendererFns.createTexture(pixels, width, height);
     stbi_image_free(pixels);
 
-    return { texID, iconWidth, iconHeight, width, height };
+    uint32_t columns = width / iconWidth;
+    uint32_t rows = height / iconHeight;
+    Texture* icons = GTexGui->iconSheets.emplace_back(new Texture[columns * rows]).get();
+    for (uint32_t y = 0; y < rows; y++)
+    {
+        for (uint32_t x = 0; x < columns; x++)
+        {
+            Math::ibox bounds = { int(x * iconWidth), int((y + 1) * iconHeight), int(iconWidth), int(iconHeight) };
+            icons[y * columns + x] = {texID, bounds, Math::ivec2{width, height}, 0, 0, 0, 0};
+        }
+    }
+
+    return { texID, iconWidth, iconHeight, width, height, icons, columns, rows };
 }
 
 // We just need pointer stability, we aren't gonna be iterating it so using list :P
@@ -276,14 +307,32 @@ static std::list<Texture> m_custom_texs;
 
 Texture* TexGui::getTexture(const char* name)
 {
-    if (!GTexGui->textures.contains(name)) return nullptr;
-    return &GTexGui->textures[name];
+    return GTexGui->textures.get(GTexGui->textures.find(name));
 }
 
 Font* TexGui::getFont(const char* name)
 {
-    if (!GTexGui->fonts.contains(name)) return nullptr;
-    return &GTexGui->fonts[name];
+    return GTexGui->fonts.get(GTexGui->fonts.find(name));
+}
+
+TextureHandle TexGui::getTextureHandle(std::string_view name)
+{
+    return {GTexGui->textures.find(name)};
+}
+
+Texture* TexGui::getTexture(TextureHandle handle)
+{
+    return GTexGui->textures.get(handle.index);
+}
+
+FontHandle TexGui::getFontHandle(std::string_view name)
+{
+    return {GTexGui->fonts.find(name)};
+}
+
+Font* TexGui::getFont(FontHandle handle)
+{
+    return GTexGui->fonts.get(handle.index);
 }
 /*
 Texture* TexGui::customTexture(unsigned int texID, Math::ibox pixelBounds)
@@ -308,20 +357,21 @@ Math::fbox Arrange(TGContainer* c, Math::fbox child)
 
 struct InputFrame
 {
-    int keyStates[TexGuiKey_NamedKey_COUNT];
-    int mouseStates[TEXGUI_MOUSE_BUTTON_COUNT];
+    KeyBitset<TexGuiKey_NamedKey_COUNT> keys;
+    KeyBitset<TEXGUI_MOUSE_BUTTON_COUNT> mouse;
     int mods;
 
-    int& lmb = mouseStates[0];
+    inline bool lmbPressed() const { return mouse.isPressed(0); }
+    inline bool lmbReleased() const { return mouse.isReleased(0); }
+    inline bool lmbHeld() const { return mouse.isHeld(0); }
+    inline bool lmbDown() const { return mouse.isDown(0); }
 
     TexGui::Math::fvec2 cursorPos;
     TexGui::Math::fvec2 mouseRelativeMotion;
     TexGui::Math::fvec2 scroll;
 
-    //unsigned int character;
-    char text[TEXGUI_TEXT_BUF_SIZE];
-
-    //int& backspace = keyStates[TexGuiKey_Backspace];
+    // utf8 text typed this frame
+    std::string text;
 };
 InputFrame inputFrame;
 
@@ -330,47 +380,91 @@ Math::fvec2 TexGui::getCursorPos()
     return inputFrame.cursorPos;
 }
 
-// There are two input states, the one in GTexGui and inputFrame.
-// updateInput() is called in TexGui::clear().
-// GTexGui->io is submittetd to inputFrame, then cleared.
+// Backends push timestamped events into GTexGui->io.queue (possibly from another thread).
+// updateInput() is called in TexGui::clear(), and drains the queue into inputFrame.
 inline static void updateInput()
 {
     auto& io = GTexGui->io;
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
-
-    //we don't clear this one
-    inputFrame.mods = io.mods;
-
-    inputFrame.cursorPos = io.cursorPos;
-    inputFrame.scroll = io.scroll;
-    inputFrame.mouseRelativeMotion = io.mouseRelativeMotion;
-
-    io.mouseRelativeMotion = {0, 0};
+    inputFrame.mouseRelativeMotion = {0, 0};
+    inputFrame.scroll = {0, 0};
+    inputFrame.text.clear();
 
     GTexGui->lastCapturingMouse = GTexGui->capturingMouse;
     GTexGui->capturingMouse = false;
-    io.scroll = {0, 0};
 
-    memcpy(inputFrame.mouseStates, io.mouseStates, sizeof(int) * TEXGUI_MOUSE_BUTTON_COUNT);
-    memcpy(inputFrame.keyStates, io.keyStates, sizeof(int) * TexGuiKey_NamedKey_COUNT);
-    //if press and release happen too fast (glfw thread polling faster than sim thread), the press event can be lost. but that never should happen so watever
-    for (int i = 0; i < TEXGUI_MOUSE_BUTTON_COUNT; i++)
+    inputFrame.mouse.newFrame();
+    inputFrame.keys.newFrame();
+
+    int64_t frameStart = inputTimestamp();
+    while (const InputEvent* e = io.queue.peek())
     {
-        if (io.mouseStates[i] == KEY_Press) io.mouseStates[i] = KEY_Held;
-        if (io.mouseStates[i] == KEY_Release) io.mouseStates[i] = KEY_Off;
+        if (e->timestamp > frameStart) break;
+
+        switch (e->type)
+        {
+            case INPUT_EVENT_Key:
+                if (e->key.key <= TexGuiKey_None || e->key.key >= TexGuiKey_NamedKey_COUNT)
+                    break;
+                if (!inputFrame.keys.apply(e->key.key, e->key.down, e->key.repeat))
+                    return;
+                inputFrame.mods = e->key.mods;
+                break;
+            case INPUT_EVENT_MouseButton:
+                if (e->mouseButton.button < 0 || e->mouseButton.button >= TEXGUI_MOUSE_BUTTON_COUNT)
+                    break;
+                if (!inputFrame.mouse.apply(e->mouseButton.button, e->mouseButton.down, false))
+                    return;
+                break;
+            case INPUT_EVENT_MouseMotion:
+                inputFrame.cursorPos = e->motion.pos;
+                inputFrame.mouseRelativeMotion.x += e->motion.relative.x;
+                inputFrame.mouseRelativeMotion.y += e->motion.relative.y;
+                break;
+            case INPUT_EVENT_MouseWheel:
+                inputFrame.scroll.x += e->wheel.x;
+                inputFrame.scroll.y += e->wheel.y;
+                break;
+            case INPUT_EVENT_Text:
+                inputFrame.text.append(e->text.utf8, e->text.len);
+                break;
+        }
+
+        io.queue.pop();
     }
+}
+
+// Counts a lazy icon that shows the texture, see releaseLazyIconTexture()
+static void retainLazyIconTexture(Texture* texture)
+{
+    auto& g = *GTexGui;
+    if (g.lazyIconTextureRefs[texture]++ != 0) return;
+
+    // its upload may have been dropped when another icon showing it was evicted
+    std::lock_guard lock(g.uploadMutex);
+    for (PendingUpload& up : g.pendingUploads)
+        if (up.texture == texture) up.evicted = false;
+}
+
+// Once no lazy icon shows the texture, frees it, or drops its upload if clear() hasn't uploaded it yet
+static void releaseLazyIconTexture(Texture* texture)
+{
+    auto& g = *GTexGui;
+    auto it = g.lazyIconTextureRefs.find(texture);
+    assert(it != g.lazyIconTextureRefs.end());
+    if (--it->second != 0) return;
+    g.lazyIconTextureRefs.erase(it);
 
-    for (int i = 0; i < TexGuiKey_NamedKey_COUNT; i++)
+    if (texture->id != uint32_t(-1))
     {
-        if (io.keyStates[i] == KEY_Press) io.keyStates[i] = KEY_Held;
-        if (io.keyStates[i] == KEY_Repeat) io.keyStates[i] = KEY_Held;
-        if (io.keyStates[i] == KEY_Release) io.keyStates[i] = KEY_Off;
+        g.rendererFns.destroyTexture(texture->id);
+        texture->id = -1;
+        return;
     }
 
-    strcpy(inputFrame.text, io.text);
-
-    io.text[0] = '\0';
+    std::lock_guard lock(g.uploadMutex);
+    for (PendingUpload& up : g.pendingUploads)
+        if (up.texture == texture) up.evicted = true;
 }
 
 void TexGui::clear()
@@ -380,47 +474,108 @@ void TexGui::clear()
     currentTime = stc::steady_clock::now();
 
     auto& g = *GTexGui;
-    g.codepoints.clear();
-    g.containers.clear();
-    g.containers.reserve(2048);
+    for (TGContainer* m = g.measuredContainers; m; m = m->nextMeasured)
+        g.layoutCache[m->layoutId] = {m->bounds.size.width, m->measured};
+    g.measuredContainers = nullptr;
+
+    g.frameArena.reset();
+    g.renderDataPoolUsed = 0;
     auto& c = g.baseContainer;
+    c.childCount = 0;
 
     //#TODO: waste to call "getscreensize" here again but who actually gaf
     c.bounds = {{0,0}, g.getScreenSize()};
     c.scissor = c.bounds;
 
-    if (g.hoveredWidget == 0 && inputFrame.lmb == KEY_Press)
+    if (g.hoveredWidget == 0 && inputFrame.lmbPressed())
     {
         g.activeWidget = 0;
     }
     g.hoveredWidget = 0;
 
     updateInput();
-    for (auto& win : GTexGui->windows)
+
     {
-        win.second.prevVisible = win.second.visible;
-        win.second.visible = false;
+        std::lock_guard lock(g.uploadMutex);
+        for (PendingUpload& up : g.pendingUploads)
+        {
+            if (up.evicted) continue;
+            // reloaded after being evicted before the first upload happened
+            if (up.texture->id != uint32_t(-1))
+                g.rendererFns.destroyTexture(up.texture->id);
+            up.texture->id = g.rendererFns.createTexture(up.pixels.data(), up.width, up.height);
+        }
+        g.pendingUploads.clear();
+    }
+    {
+        std::lock_guard lock(g.lazyIconLoader.mutex);
+        for (auto& res : g.lazyIconLoader.results)
+        {
+            LazyIconState* state = g.lazyIcons.find(res.key);
+            while (state && !(state->icon == res.icon))
+                state = state->next.get();
+            if (res.texture)
+                retainLazyIconTexture(res.texture);
+            if (!state || state->status != LAZY_ICON_Loading)
+            {
+                // evicted while loading
+                if (res.texture)
+                    releaseLazyIconTexture(res.texture);
+                continue;
+            }
+            state->texture = res.texture;
+            state->status = res.texture ? LAZY_ICON_Ready : LAZY_ICON_Failed;
+        }
+        g.lazyIconLoader.results.clear();
     }
-}
 
-void TexGui::destroy()
-{
-    GTexGui->rendererFns.renderClean();
-    for (auto& style : GTexGui->styleStack)
+    g.frame++;
+    g.windows.frame = g.textInputs.frame = g.scrollPanels.frame = g.animations.frame = g.layoutCache.frame = g.listClippers.frame = g.frame;
+    if (g.widgetStateLifetime != 0)
+    {
+        uint64_t maxAge = g.widgetStateLifetime;
+        g.windows.sweep(maxAge, TEXGUI_GC_STEPS, [&](TexGuiID, TexGuiWindow& win) { g.windowOrder.unlink(&win); });
+        g.textInputs.sweep(maxAge, TEXGUI_GC_STEPS, [](TexGuiID, TextInputState&) {});
+        g.scrollPanels.sweep(maxAge, TEXGUI_GC_STEPS, [](TexGuiID, ScrollPanelState&) {});
+        g.animations.sweep(maxAge, TEXGUI_GC_STEPS, [](TexGuiID, Animation&) {});
+        g.layoutCache.sweep(maxAge, TEXGUI_GC_STEPS, [](TexGuiID, LayoutCacheEntry&) {});
+        g.listClippers.sweep(maxAge, TEXGUI_GC_STEPS, [](TexGuiID, ListClipperState&) {});
+    }
+    g.lazyIcons.frame = g.frame;
+    if (g.lazyIconLifetime != 0)
     {
-        delete style;
+        g.lazyIcons.sweep(g.lazyIconLifetime, TEXGUI_GC_STEPS, [&](TexGuiID, LazyIconState& chain) {
+            for (LazyIconState* icon = &chain; icon; icon = icon->next.get())
+                if (icon->status == LAZY_ICON_Ready)
+                    releaseLazyIconTexture(icon->texture);
+        });
     }
-    delete GTexGui;
-}
 
-inline void setBit(unsigned int& dest, const unsigned int flag, bool on)
-{
-    dest = on ? dest | flag : dest & ~(flag);
+    // Single front-to-back pass over the windows: number the normal ones (the focused window takes 0 mid-frame),
+    // and find the front-most window under the cursor.
+    g.cursorWindow = nullptr;
+    int32_t order = 1;
+    for (int layer = 0; layer < WINDOW_LAYER_COUNT; layer++)
+    {
+        for (TexGuiWindow* win = g.windowOrder.head[layer]; win; win = win->zNext)
+        {
+            win->prevVisible = win->visible;
+            win->visible = false;
+
+            if (layer == WINDOW_LAYER_Normal)
+                win->order = order++;
+
+            if (!g.cursorWindow && win->prevVisible && win->box.contains(inputFrame.cursorPos))
+                g.cursorWindow = win;
+        }
+    }
 }
 
-inline bool getBit(const unsigned int dest, const unsigned int flag)
+void TexGui::destroy()
 {
-    return dest & flag;
+    GTexGui->lazyIconLoader.stop();
+    GTexGui->rendererFns.renderClean();
+    delete GTexGui;
 }
 
 using namespace TexGui::Math;
@@ -438,7 +593,7 @@ fbox intToFloatBox(ibox box)
 ContainerState getState(TexGuiID id, TGContainer* c, const fbox& bounds, const fbox& scissor)
 {
 #define TG_STATE_HOVERED(rect) rect.contains(inputFrame.cursorPos) && c->window && c->window->state & STATE_HOVER && scissor.contains(inputFrame.cursorPos)
-#define TG_STATE_CLICKED(rect) rect.contains(inputFrame.cursorPos) && inputFrame.lmb == KEY_Press && c->window && c->window->state & STATE_HOVER && scissor.contains(inputFrame.cursorPos)
+#define TG_STATE_CLICKED(rect) rect.contains(inputFrame.cursorPos) && inputFrame.lmbPressed() && c->window && c->window->state & STATE_HOVER && scissor.contains(inputFrame.cursorPos)
     ContainerState state = 0;
     if (TG_STATE_HOVERED(bounds))
     {
@@ -451,7 +606,7 @@ ContainerState getState(TexGuiID id, TGContainer* c, const fbox& bounds, const f
         state |= STATE_PRESS;
     }
     if (GTexGui->activeWidget == id) state |= STATE_ACTIVE;
-    if (GTexGui->activeWidget == id && inputFrame.lmb == KEY_Held) state |= STATE_PRESS;
+    if (GTexGui->activeWidget == id && inputFrame.lmbHeld()) state |= STATE_PRESS;
     return state;
 #undef TG_STATE_HOVERED
 #undef TG_STATE_CLICKED
@@ -464,12 +619,12 @@ uint32_t getBoxState(uint32_t& state, fbox box, uint32_t parentState)
     {
         state |= STATE_HOVER;
 
-        if (io.lmb == KEY_Press) {
+        if (io.lmbPressed()) {
             state |= STATE_PRESS;
             state |= STATE_ACTIVE;
         }
 
-        if (io.lmb == KEY_Release)
+        if (io.lmbReleased())
             setBit(state, STATE_PRESS, 0);
 
         // if parent state is not active, it cant be active
@@ -487,7 +642,7 @@ uint32_t getBoxState(uint32_t& state, fbox box, uint32_t parentState)
     setBit(state, STATE_HOVER, 0);
     setBit(state, STATE_PRESS, 0);
 
-    if (io.lmb == KEY_Press || !(parentState & STATE_ACTIVE))
+    if (io.lmbPressed() || !(parentState & STATE_ACTIVE))
         setBit(state, STATE_ACTIVE, 0);
 
     return state;
@@ -579,9 +734,26 @@ Math::fvec2 calculateUnscaledTextSize(uint16_t* codepointStart, uint32_t len, Fo
     return out;
 }
 
+// Child RenderData comes from a pool that is recycled every frame, so its buffers keep their capacity
+static RenderData* newChildRenderData(RenderData* parent)
+{
+    auto& g = *GTexGui;
+    if (g.renderDataPoolUsed == g.renderDataPool.size())
+        g.renderDataPool.emplace_back();
+
+    RenderData* rd = &g.renderDataPool[g.renderDataPoolUsed++];
+    rd->clear();
+    rd->priority = -1;
+    rd->alphaModifier = 0x000000FF;
+    parent->children.push_back(rd);
+    return rd;
+}
+
+// The decoded codepoints live in the frame arena until the next TexGui::clear()
 bool decodeUTF8(const TGStr& text, uint16_t** startOut, uint32_t* lenOut)
 {
-    GTexGui->codepoints.clear();
+    // a codepoint is at least one byte
+    uint16_t* codepoints = GTexGui->frameArena.alloc<uint16_t>(text.len);
     uint32_t curr = 0;
     *lenOut = 0;
     //#TODO: more invalid string checks
@@ -625,30 +797,40 @@ bool decodeUTF8(const TGStr& text, uint16_t** startOut, uint32_t* lenOut)
             codepoint = text.utf8[curr++];
         }
 
-        GTexGui->codepoints.push_back(codepoint);
+        codepoints[*lenOut] = codepoint;
         *lenOut += 1;
     }
-    *startOut = *lenOut == 0 ? nullptr : &GTexGui->codepoints[0];
+    *startOut = *lenOut == 0 ? nullptr : codepoints;
 }
 
 // [Widgets]
 
+static TGContainer* windowImpl(TexGuiID hash, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags, WindowStyle* style);
+
 TGContainer* TexGui::Window(const char* id, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags, WindowStyle* style)
+{
+    return windowImpl(ImHashStr(id, strlen(id), -1), name, xpos, ypos, width, height, flags, style);
+}
+
+TGContainer* TexGui::Window(TGID id, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags, WindowStyle* style)
+{
+    return windowImpl(ImHashCombine(id.hash, -1), name, xpos, ypos, width, height, flags, style);
+}
+
+static TGContainer* windowImpl(TexGuiID hash, TGStr name, float xpos, float ypos, float width, float height, uint32_t flags, WindowStyle* style)
 {
     auto& io = inputFrame;
     auto& g = *GTexGui;
-    TexGuiID hash = ImHashStr(id, strlen(id), -1);
     if (!GTexGui->windows.contains(hash))
     {
-        for (auto& entry : GTexGui->windows)
-        {
-            if (entry.second.order != INT_MAX) entry.second.order++;
-        }
-
-        GTexGui->windows.insert({hash, TexGuiWindow{
-            .id = int(GTexGui->windows.size()),
+        // New windows go in front
+        int id = g.nextWindowId++;
+        auto& win = GTexGui->windows[hash];
+        win = TexGuiWindow{
+            .id = id,
             .box = {xpos, ypos, width, height},
-        }});
+        };
+        g.windowOrder.pushFront(&win, WINDOW_LAYER_Normal);
     }
 
     if (style == nullptr)
@@ -674,6 +856,10 @@ TGContainer* TexGui::Window(const char* id, TGStr name, float xpos, float ypos,
     if (flags & LOCKED || !wstate.prevVisible || animationActive)
         wstate.box = box;
 
+    WindowLayer layer = flags & FRONT ? WINDOW_LAYER_Front : flags & BACK ? WINDOW_LAYER_Back : WINDOW_LAYER_Normal;
+    if (layer != wstate.layer)
+        g.windowOrder.bringToFront(&wstate, layer);
+
     if (flags & BACK)
         wstate.order = INT_MAX;
     if (flags & FRONT)
@@ -682,41 +868,31 @@ TGContainer* TexGui::Window(const char* id, TGStr name, float xpos, float ypos,
     if (flags & CAPTURE_INPUT && wstate.box.contains(io.cursorPos)) GTexGui->capturingMouse = true;
 
     //if there is a window over the window being clicked, set state to 0
+    //cursorWindow is the front-most window under the cursor, so it's enough to check if it is in front of this one
     getBoxState(wstate.state, wstate.box, STATE_ALL);
-    if (wstate.order > 0 && wstate.state != STATE_NONE && wstate.box.contains(io.cursorPos))
+    if (g.cursorWindow && g.cursorWindow != &wstate && g.cursorWindow->order < wstate.order
+        && wstate.state != STATE_NONE && wstate.box.contains(io.cursorPos))
     {
-        for (auto& entry : GTexGui->windows)
-        {
-            if (!entry.second.prevVisible || entry.second.order >= wstate.order) continue;
-            if (entry.second.box.contains(io.cursorPos)) {
-                wstate.state = STATE_NONE;
-                break;
-            }
-        }
+        wstate.state = STATE_NONE;
     }
 
     //bring focused window to the front (0), if it doesnt have a FRONT or BACK flag
     if (!(flags & FORCED_ORDER) && wstate.state & STATE_ACTIVE && wstate.order > 0)
     {
-        int order = wstate.order;
-        for (auto& entry : GTexGui->windows)
-        {
-            if (entry.second.order < order && entry.second.order > -1) entry.second.order++;
-        }
-
+        g.windowOrder.bringToFront(&wstate, WINDOW_LAYER_Normal);
         wstate.order = 0;
     }
 
-    if (flags & LOCKED || !(io.lmb & (KEY_Held | KEY_Press)) || !(wstate.state & STATE_ACTIVE))
+    if (flags & LOCKED || !io.lmbDown() || !(wstate.state & STATE_ACTIVE))
     {
         wstate.moving = false;
         wstate.resizing = false;
     }
-    else if (fbox{wstate.box.pos.x, wstate.box.pos.y, wstate.box.size.width, wintex->top * _PX}.contains(io.cursorPos) && io.lmb == KEY_Press)
+    else if (fbox{wstate.box.pos.x, wstate.box.pos.y, wstate.box.size.width, wintex->top * _PX}.contains(io.cursorPos) && io.lmbPressed())
         wstate.moving = true;
     else if (flags & RESIZABLE && fbox{wstate.box.pos.x + wstate.box.size.width - wintex->right * _PX,
              wstate.box.pos.y + wstate.box.size.height - wintex->bottom * _PX,
-             wintex->right * _PX, wintex->bottom * _PX}.contains(io.cursorPos) && io.lmb == KEY_Press)
+             wintex->right * _PX, wintex->bottom * _PX}.contains(io.cursorPos) && io.lmbPressed())
         wstate.resizing = true;
 
     if (wstate.moving)
@@ -736,10 +912,11 @@ TGContainer* TexGui::Window(const char* id, TGStr name, float xpos, float ypos,
 
     g.renderData->ordered = true;
 
-    TGContainer* child = &g.containers.emplace_back();
+    TGContainer* child = g.frameArena.create<TGContainer>();
 
     child->bounds = internal;
-    child->renderData = &g.renderData->children.emplace_back();
+    child->layoutId = hash;
+    child->renderData = newChildRenderData(g.renderData);
     child->window = &wstate;
     child->renderData->priority = -wstate.order;
     child->renderData->alphaModifier = alpha;
@@ -761,11 +938,22 @@ TGContainer* TexGui::Window(const char* id, TGStr name, float xpos, float ypos,
     return child;
 }
 
+static bool buttonImpl(TGContainer* c, TexGuiID bid, TGStr text, TexGui::ButtonStyle* style);
+
 bool TexGui::Button(TGContainer* c, const char* id, TGStr text, TexGui::ButtonStyle* style)
+{
+    return buttonImpl(c, c->window->getID(id), text, style);
+}
+
+bool TexGui::Button(TGContainer* c, TGID id, TGStr text, TexGui::ButtonStyle* style)
+{
+    return buttonImpl(c, c->window->getID(id), text, style);
+}
+
+static bool buttonImpl(TGContainer* c, TexGuiID bid, TGStr text, TexGui::ButtonStyle* style)
 {
     auto& g = *GTexGui;
     auto& io = inputFrame;
-    TexGuiID bid = c->window->getID(id);
 
     fbox internal = Arrange(c, c->bounds);
 
@@ -798,7 +986,7 @@ bool TexGui::Button(TGContainer* c, const char* id, TGStr text, TexGui::ButtonSt
     bool hovered = c->scissor.contains(io.cursorPos)
                 && c->bounds.contains(io.cursorPos);
 
-    return state & STATE_ACTIVE && io.lmb == KEY_Release && hovered ? true : false;
+    return state & STATE_ACTIVE && io.lmbReleased() && hovered ? true : false;
 }
 
 TGContainer* TexGui::Box(TGContainer* c, float xpos, float ypos, float width, float height, uint32_t flags, TexGui::BoxStyle* style)
@@ -821,11 +1009,12 @@ TGContainer* TexGui::Box(TGContainer* c, float xpos, float ypos, float width, fl
         box.pos.y += ypos;
 
     fbox internal = fbox::pad(box, style->Padding);
-    TGContainer* child = &GTexGui->containers.emplace_back();
+    TGContainer* child = GTexGui->frameArena.create<TGContainer>();
 
     child->size = box;
     child->bounds = internal;
-    child->renderData = &c->renderData->children.emplace_back();
+    child->layoutId = ImHashCombine(c->layoutId, c->childCount++);
+    child->renderData = newChildRenderData(c->renderData);
     child->window = c->window;
     //child->renderData->colorMultiplier = color;
     child->scissor = box;
@@ -847,7 +1036,7 @@ bool TexGui::CheckBox(TGContainer* c, bool* val, TexGui::CheckBoxStyle* style)
 
     auto& io = inputFrame;
     bool pressed = false;
-    if (io.lmb == KEY_Release && c->bounds.contains(io.cursorPos) && c->window->state & STATE_HOVER) 
+    if (io.lmbReleased() && c->bounds.contains(io.cursorPos) && c->window->state & STATE_HOVER) 
     {
         *val = !*val;
         pressed = true;
@@ -867,7 +1056,7 @@ void TexGui::RadioButton(TGContainer* c, uint32_t* selected, uint32_t id, RadioB
     Texture* texture = style->Texture;
 
     auto& io = inputFrame;
-    if (io.lmb == KEY_Release && c->bounds.contains(io.cursorPos) && c->window->state & STATE_HOVER) *selected = id;
+    if (io.lmbReleased() && c->bounds.contains(io.cursorPos) && c->window->state & STATE_HOVER) *selected = id;
 
     if (texture == nullptr) return;
     c->renderData->addTexture(c->bounds, texture, *selected == id ? STATE_ACTIVE : 0, 2, SLICE_9);
@@ -879,26 +1068,77 @@ void TexGui::Line(TGContainer* c, float x1, float y1, float x2, float y2, uint32
     c->renderData->addLine(c->bounds.pos.x + x1, c->bounds.pos.y + y1, c->bounds.pos.x + x2, c->bounds.pos.y + y2, color, lineWidth);
 }
 
-TGContainer* createChild(TGContainer* c, Math::fbox bounds, ArrangeFunc arrange = nullptr)
+static void initChild(TGContainer* child, TGContainer* c, Math::fbox bounds, ArrangeFunc arrange = nullptr)
 {
-    TGContainer* child = &GTexGui->containers.emplace_back();
     child->bounds = bounds;
     child->scissor = !c ? Math::fbox({0,0}, GTexGui->getScreenSize()) : c->scissor;
     child->parent = c;
     child->arrangeProc = arrange;
     child->window = !c ? nullptr : c->window;
     child->renderData = !c ? GTexGui->renderData : c->renderData;
+    child->layoutId = !c ? 0 : ImHashCombine(c->layoutId, c->childCount++);
+}
+
+TGContainer* createChild(TGContainer* c, Math::fbox bounds, ArrangeFunc arrange = nullptr)
+{
+    TGContainer* child = GTexGui->frameArena.create<TGContainer>();
+    initChild(child, c, bounds, arrange);
     return child;
 }
 
+// Measure/arrange for containers sized by their children.
+// Children are measured into c->measured, and the parent arranges the container once with that size.
+// The size is only final once every child is added, so the parent gets last frame's size from the layout cache
+// right away, which keeps adding a child O(1). On a cache miss (first frame, or the width changed) the parent is
+// re-arranged with the size so far on every child instead.
+// The measured size only grows as children are added, so once it outgrows the cached one the parent is re-arranged
+// as on a miss, in the same frame. A container that shrank can't know it before its last child, its parent keeps
+// last frame's size until the next one.
+static void beginMeasure(TGContainer* c)
+{
+    auto& g = *GTexGui;
+    c->nextMeasured = g.measuredContainers;
+    g.measuredContainers = c;
+
+    LayoutCacheEntry* cached = g.layoutCache.find(c->layoutId);
+    if (!cached || cached->width != c->bounds.size.width)
+        return;
+
+    c->layoutCached = true;
+    c->arranged = cached->size;
+    if (cached->size.x > 0 || cached->size.y > 0)
+        Arrange(c->parent, {c->bounds.pos.x, c->bounds.pos.y, cached->size.x, cached->size.y});
+}
+
+static void measure(TGContainer* c, Math::fvec2 size)
+{
+    c->measured = size;
+    if (c->layoutCached && size.x <= c->arranged.x && size.y <= c->arranged.y)
+        return;
+
+    c->arranged = size;
+    Arrange(c->parent, {c->bounds.pos, size});
+}
+
+static TGContainer* beginScrollPanelImpl(TGContainer* c, TexGuiID id, ScrollPanelStyle* style);
+
 TGContainer* TexGui::BeginScrollPanel(TGContainer* c, const char* name, ScrollPanelStyle* style)
+{
+    return beginScrollPanelImpl(c, c->window->getID(name), style);
+}
+
+TGContainer* TexGui::BeginScrollPanel(TGContainer* c, TGID name, ScrollPanelStyle* style)
+{
+    return beginScrollPanelImpl(c, c->window->getID(name), style);
+}
+
+static TGContainer* beginScrollPanelImpl(TGContainer* c, TexGuiID id, ScrollPanelStyle* style)
 {
     if (style == nullptr)
         style = &GTexGui->styleStack.back()->ScrollPanel;
     Texture* texture = style->PanelTexture;
     Texture* bartex = style->BarTexture;
     auto& io = inputFrame;
-    TexGuiID id = c->window->getID(name);
     if (!GTexGui->scrollPanels.contains(id))
     {
         ScrollPanelState _s =
@@ -906,7 +1146,7 @@ TGContainer* TexGui::BeginScrollPanel(TGContainer* c, const char* name, ScrollPa
             .contentPos = {0,0},
             .bounds = c->bounds
         };
-        GTexGui->scrollPanels.insert({id, _s});
+        GTexGui->scrollPanels[id] = _s;
     }
 
     auto& spstate = GTexGui->scrollPanels[id];
@@ -954,9 +1194,9 @@ TGContainer* TexGui::BeginScrollPanel(TGContainer* c, const char* name, ScrollPa
     sp->scissor = sp->bounds;
     c->renderData->pushScissor(sp->bounds);
 
-    if (bar.contains(io.cursorPos) && io.lmb == KEY_Press)
+    if (bar.contains(io.cursorPos) && io.lmbPressed())
         spstate.scrolling = true;
-    else if (io.lmb != KEY_Held)
+    else if (!io.lmbHeld())
         spstate.scrolling = false;
 
     sp->bounds.pos.y += spstate.contentPos.y;
@@ -996,7 +1236,7 @@ int TexGui::SliderInt(TGContainer* c, int* val, int minVal, int maxVal, SliderSt
     uint32_t state = getState(id, c, barArea, c->scissor);
     c->renderData->addTexture(barArea, bar, state, _PX, SLICE_3_HORIZONTAL);
 
-    if (g.activeWidget == id && io.lmb == KEY_Held)
+    if (g.activeWidget == id && io.lmbHeld())
     {
         float p = clamp(float(io.cursorPos.x - barArea.pos.x) / barArea.size.width, 0.f, 1.f);
         *val = minVal + p * (maxVal - minVal);
@@ -1044,6 +1284,36 @@ void TexGui::Image(TGContainer* c, Texture* texture, uint32_t colorOverride, int
 
     c->renderData->addTexture(arranged, texture, STATE_NONE, scale, 0, colorOverride);
 }
+
+void TexGui::Image(TGContainer* c, LazyIcon icon, int scale)
+{
+    auto& g = *GTexGui;
+    // hashed field by field, so padding between them doesn't end up in the key
+    TexGuiID key = ImHashData(&icon.data, sizeof(icon.data), ImHashData(&icon.func, sizeof(icon.func), 0));
+    assert(icon.func);
+    LazyIconState* found = &g.lazyIcons[key];
+    while (found->icon.func && !(found->icon == icon))
+    {
+        // another icon with the same hash
+        if (!found->next)
+            found->next.reset(new LazyIconState());
+        found = found->next.get();
+    }
+    LazyIconState& state = *found;
+
+    if (state.status == LAZY_ICON_Unloaded)
+    {
+        state.icon = icon;
+        state.status = LAZY_ICON_Loading;
+        g.lazyIconLoader.push({key, icon});
+    }
+
+    if (state.status == LAZY_ICON_Ready && state.texture->id != uint32_t(-1))
+        Image(c, state.texture, scale);
+    else
+        Image(c, g.lazyIconPlaceholder, scale);
+}
+
 /*
 bool Container::DropdownInt(int* val, std::initializer_list<std::pair<const char*, int>> names)
 {
@@ -1093,7 +1363,8 @@ TGContainer* TexGui::BeginTooltip(Math::fvec2 size, TooltipStyle* style)
 
     auto& g = *GTexGui;
     fbox internal = fbox::pad(rect, style->Padding);
-    TGContainer* child = &g.containers.emplace_back();
+    TGContainer* child = g.frameArena.create<TGContainer>();
+    child->layoutId = ImHashStrConst("##tooltip", 0);
     child->box.width = size.x;
     child->box.height = size.y;
     child->bounds = internal;
@@ -1105,9 +1376,9 @@ TGContainer* TexGui::BeginTooltip(Math::fvec2 size, TooltipStyle* style)
     child->arrangeProc = arrange;
 
     //this is scuffed
-    child->parentRenderData = &g.renderData->children.emplace_back();
+    child->parentRenderData = newChildRenderData(g.renderData);
     child->parentRenderData->priority = INT_MAX;
-    child->renderData = &child->parentRenderData->children.emplace_back();
+    child->renderData = newChildRenderData(child->parentRenderData);
     child->renderData->priority;
     //child->renderData->colorMultiplier = renderData->colorMultiplier;
 
@@ -1142,7 +1413,7 @@ TGContainer* TexGui::ListItem(TGContainer* c, uint32_t* selected, uint32_t id, L
 
             // can always be active
             getBoxState(state, bounds, listItem->window->state);
-            if (io.lmb == KEY_Press && state & STATE_HOVER)
+            if (io.lmbPressed() && state & STATE_HOVER)
                 *(listItem->listItem.selected) = listItem->listItem.id;
 
             if (*(listItem->listItem.selected) == listItem->listItem.id)
@@ -1211,7 +1482,7 @@ TGContainer* TexGui::Grid(TGContainer* c, TexGui::GridStyle* style)
 
         gs.x += child.size.width + spacing;
 
-        Arrange(grid->parent, {grid->bounds.pos.x, grid->bounds.pos.y, grid->bounds.size.width, gs.y + gs.rowHeight + spacing});
+        measure(grid, {grid->bounds.size.width, gs.y + gs.rowHeight + spacing});
 
         gs.n++;
 
@@ -1221,6 +1492,7 @@ TGContainer* TexGui::Grid(TGContainer* c, TexGui::GridStyle* style)
         style = &GTexGui->styleStack.back()->Grid;
     TGContainer* grid = createChild(c, c->bounds, arrange);
     grid->grid = { 0, 0, 0, 0, style->Spacing };
+    beginMeasure(grid);
     return grid;
 }
 
@@ -1244,9 +1516,9 @@ TGContainer* TexGui::Stack(TGContainer* c, float padding, StackStyle* style)
         child.pos.y = stack->bounds.pos.y + s.y;
 
         s.y += child.size.y + s.padding;
+        s.maxWidth = fmax(s.maxWidth, child.size.width);
 
-        //TexGui::Arrange(child);
-        Arrange(stack->parent, {stack->bounds.pos.x, stack->bounds.pos.y, child.size.width, s.y});
+        measure(stack, {s.maxWidth, s.y});
 
         return child;
     };
@@ -1255,9 +1527,125 @@ TGContainer* TexGui::Stack(TGContainer* c, float padding, StackStyle* style)
         style = &GTexGui->styleStack.back()->Stack;
     TGContainer* stack = createChild(c, c->bounds, arrange);
     stack->stack = {0, padding < 0 ? style->Padding : padding, 0};
+    beginMeasure(stack);
     return stack;
 }
 
+static inline int32_t clampIndex(float v, int32_t lo, int32_t hi)
+{
+    return v <= lo ? lo : v >= hi ? hi : int32_t(v);
+}
+
+TexGui::ListClipper::ListClipper(TGContainer* stack, int32_t itemCount, float itemHeight)
+    : list(stack), grid(false), count(itemCount), columns(1), cellSize{0, itemHeight}
+{
+    auto& s = stack->stack;
+    float stride = itemHeight + s.padding;
+    top = s.y;
+    total = stride * itemCount;
+
+    if (stride <= 0)
+    {
+        end = count;
+        return;
+    }
+
+    float viewTop = stack->scissor.pos.y - (stack->bounds.pos.y + top);
+    float viewBottom = viewTop + stack->scissor.size.height;
+    start = clampIndex(floorf(viewTop / stride), 0, count);
+    end = clampIndex(ceilf(viewBottom / stride), start, count);
+
+    s.y += start * stride;
+}
+
+TexGui::ListClipper::ListClipper(TGContainer* stack, std::span<const float> itemHeights, uint32_t version)
+    : list(stack), grid(false), count(int32_t(itemHeights.size())), columns(1), cellSize{0, 0}
+{
+    auto& s = stack->stack;
+    auto& cs = GTexGui->listClippers[stack->layoutId];
+    if (cs.prefix.size() != itemHeights.size() + 1 || cs.version != version || cs.padding != s.padding)
+    {
+        cs.prefix.resize(itemHeights.size() + 1);
+        cs.prefix[0] = 0;
+        for (size_t i = 0; i < itemHeights.size(); i++)
+            cs.prefix[i + 1] = cs.prefix[i] + itemHeights[i] + s.padding;
+        cs.version = version;
+        cs.padding = s.padding;
+    }
+
+    top = s.y;
+    total = cs.prefix[count];
+
+    float viewTop = stack->scissor.pos.y - (stack->bounds.pos.y + top);
+    float viewBottom = viewTop + stack->scissor.size.height;
+    start = count == 0 ? 0 : std::min(binarySearch(cs.prefix, viewTop), count);
+    end = count == 0 ? 0 : Math::clamp(binarySearch(cs.prefix, viewBottom) + 1, start, count);
+
+    s.y += cs.prefix[start];
+}
+
+TexGui::ListClipper::ListClipper(TGContainer* grid, int32_t itemCount, Math::fvec2 cellSize)
+    : list(grid), grid(true), count(itemCount), cellSize(cellSize)
+{
+    Style& style = *GTexGui->styleStack.back();
+    auto& gs = grid->grid;
+    float spacing = gs.spacing == -1 ? style.Row.Spacing : gs.spacing;
+
+    // Start on a fresh row
+    if (gs.x > 0)
+    {
+        gs.x = 0;
+        gs.y += gs.rowHeight + spacing;
+        gs.rowHeight = 0;
+    }
+
+    columns = std::max(1, int32_t((grid->bounds.size.width + spacing) / (cellSize.x + spacing)));
+    int32_t rows = (count + columns - 1) / columns;
+    float stride = cellSize.y + spacing;
+    top = gs.y;
+    total = stride * rows;
+
+    if (stride <= 0)
+    {
+        end = count;
+        return;
+    }
+
+    float viewTop = grid->scissor.pos.y - (grid->bounds.pos.y + top);
+    float viewBottom = viewTop + grid->scissor.size.height;
+    int32_t firstRow = clampIndex(floorf(viewTop / stride), 0, rows);
+    int32_t lastRow = clampIndex(ceilf(viewBottom / stride), firstRow, rows);
+    start = std::min(firstRow * columns, count);
+    end = std::min(lastRow * columns, count);
+
+    gs.y += firstRow * stride;
+}
+
+TexGui::ListClipper::~ListClipper()
+{
+    if (!grid)
+    {
+        auto& s = list->stack;
+        s.y = top + total;
+        measure(list, {s.maxWidth, s.y});
+        return;
+    }
+
+    if (count == 0) return;
+
+    Style& style = *GTexGui->styleStack.back();
+    auto& gs = list->grid;
+    float spacing = gs.spacing == -1 ? style.Row.Spacing : gs.spacing;
+    int32_t rows = (count + columns - 1) / columns;
+
+    // Leave the grid at the end of the last row, as if every cell was added
+    gs.y = top + (rows - 1) * (cellSize.y + spacing);
+    gs.x = ((count - 1) % columns + 1) * (cellSize.x + spacing);
+    gs.rowHeight = fmax(gs.rowHeight, cellSize.y);
+    gs.n += count - (end - start);
+    measure(list, {list->bounds.size.width, gs.y + gs.rowHeight + spacing});
+}
+
 void TexGui::ProgressBar(TGContainer* c, float percentage, const ProgressBarStyle* style)
 {
     if (style == nullptr)
@@ -1341,7 +1729,7 @@ TGContainer* TexGui::Node(TGContainer* c, float x, float y)
 static bool textInputUpdate(TextInputState& tstate, char** c, CharacterFilter filter)
 {
     auto& io = inputFrame;
-    *c = io.text;
+    *c = io.text.data();
     if (!(tstate.state & STATE_ACTIVE)) return false;
 
     /*
@@ -1353,7 +1741,7 @@ static bool textInputUpdate(TextInputState& tstate, char** c, CharacterFilter fi
     }
     */
 
-    if (io.keyStates[TexGuiKey_Backspace] == KEY_Press || io.keyStates[TexGuiKey_Backspace] == KEY_Repeat)
+    if (io.keys.isPressedOrRepeat(TexGuiKey_Backspace))
     {
         return true;
     }
@@ -1397,14 +1785,14 @@ void TextInputBehaviour(TextInputState& ti, char* buf, uint32_t bufsize, int tle
     auto& g = *GTexGui;
     auto& io = inputFrame;
     //left takes priority
-    bool left = io.keyStates[TexGuiKey_LeftArrow] & (KEY_Press | KEY_Repeat) || io.keyStates[TexGuiKey_Backspace] & (KEY_Press | KEY_Repeat);
-    bool right = io.keyStates[TexGuiKey_RightArrow] & (KEY_Press | KEY_Repeat);
+    bool left = io.keys.isPressedOrRepeat(TexGuiKey_LeftArrow) || io.keys.isPressedOrRepeat(TexGuiKey_Backspace);
+    bool right = io.keys.isPressedOrRepeat(TexGuiKey_RightArrow);
 
     int dir = left ? -1 : right ? 1 : 0;
 
     if (dir != 0 && ti.selection[0] == ti.selection[1])
     {
-        if (io.keyStates[TexGuiKey_Backspace] & (KEY_Press | KEY_Repeat))
+        if (io.keys.isPressedOrRepeat(TexGuiKey_Backspace))
         {
             ti.selection[1] = ti.textCursorPos;
         }
@@ -1432,7 +1820,7 @@ void TextInputBehaviour(TextInputState& ti, char* buf, uint32_t bufsize, int tle
                 ti.textCursorPos += dir;
             }
         }
-        if (io.keyStates[TexGuiKey_Backspace] & (KEY_Press | KEY_Repeat))
+        if (io.keys.isPressedOrRepeat(TexGuiKey_Backspace))
         {
             ti.selection[0] = ti.textCursorPos;
         }
@@ -1444,14 +1832,14 @@ void TextInputBehaviour(TextInputState& ti, char* buf, uint32_t bufsize, int tle
     #else
         TexGuiMod_Ctrl
     #endif
-        && io.keyStates[TexGuiKey_A]
+        && io.keys.isDown(TexGuiKey_A)
         )
     {
         ti.selection[0] = 0;
         ti.selection[1] = tlen;
     }
 
-    if (io.keyStates[TexGuiKey_Backspace] & (KEY_Press | KEY_Repeat) || io.text[0] != '\0')
+    if (io.keys.isPressedOrRepeat(TexGuiKey_Backspace) || !io.text.empty())
     {
         if (ti.selection[0] != ti.selection[1])
         {
@@ -1462,22 +1850,23 @@ void TextInputBehaviour(TextInputState& ti, char* buf, uint32_t bufsize, int tle
             }
             tlen -= size;
             ti.textCursorPos = ti.selection[0];
+            ti.glyphXDirty = true;
         }
 
-        uint32_t newlen = strlen(io.text);
+        uint32_t newlen = io.text.size();
         if (tlen + newlen < bufsize - 1 && newlen > 0)
         {
-            if (ti.textCursorPos != tlen)
-                strcat(io.text, buf + ti.textCursorPos);
-
-            strcpy(buf + ti.textCursorPos, io.text);
+            // shift the rest of the buffer (including the terminator) along to make room
+            memmove(buf + ti.textCursorPos + newlen, buf + ti.textCursorPos, tlen - ti.textCursorPos + 1);
+            memcpy(buf + ti.textCursorPos, io.text.data(), newlen);
             ti.textCursorPos += newlen;
             tlen += newlen;
+            ti.glyphXDirty = true;
         }
     }
 
     //deselect
-    if (dir != 0 || io.text[0] != '\0')
+    if (dir != 0 || !io.text.empty())
     {
         ti.selection[0] = -1;
         ti.selection[1] = -1;
@@ -1521,17 +1910,16 @@ static void bumpline(float& x, float& y, float w, TexGui::Math::fbox& bounds, in
 
 void TexGui::Text(TGContainer* container, TexGui::TextStyle* style, const char* fmt, ...)
 {
-    va_list args;
+    va_list args, argsCopy;
     va_start(args, fmt);
-    int w = vsnprintf(GTexGui->tempBuffer.data(), GTexGui->tempBuffer.size(), fmt, args);
+    va_copy(argsCopy, args);
+    int w = vsnprintf(nullptr, 0, fmt, args);
     assert(w != -1);
-    if (w >= GTexGui->tempBuffer.size())
-    {
-        GTexGui->tempBuffer.resize(w + 1);
-        vsnprintf(GTexGui->tempBuffer.data(), GTexGui->tempBuffer.size(), fmt, args);
-    }
-    Text(container, GTexGui->tempBuffer.data(), style);
+    char* buf = GTexGui->frameArena.alloc<char>(w + 1);
+    vsnprintf(buf, w + 1, fmt, argsCopy);
+    va_end(argsCopy);
     va_end(args);
+    Text(container, TGStr{(uint8_t*)buf, size_t(w)}, style);
 }
 
 void TexGui::Text(TGContainer* container, const char* text, TexGui::TextStyle* style)
@@ -1585,8 +1973,8 @@ TGContainerArray TexGui::Row(TGContainer* c, uint32_t widthCount, const float* p
 
     float x = 0, y = 0;
     float spacing = style->Spacing;
-    TGContainerArray out;
-    out.size = n;
+    // One block, so out[i] can index it
+    TGContainerArray out = {GTexGui->frameArena.create<TGContainer>(n), size_t(n)};
     for (uint32_t i = 0; i < n; i++)
     {
         if (i != 0) x += spacing;
@@ -1606,10 +1994,7 @@ TGContainerArray TexGui::Row(TGContainer* c, uint32_t widthCount, const float* p
             y += height + spacing;
         }
 
-        if (i == 0)
-            out.data = createChild(c, {x, y, width, height});
-        else
-            createChild(c, {x, y, width, height});
+        initChild(&out.data[i], c, {x, y, width, height});
 
         x += width;
     }
@@ -1645,8 +2030,7 @@ TGContainerArray TexGui::Column(TGContainer* c, uint32_t heightCount, const floa
 
     float x = 0, y = 0;
     float spacing = style->Spacing;
-    TGContainerArray out;
-    out.size = n;
+    TGContainerArray out = {GTexGui->frameArena.create<TGContainer>(n), size_t(n)};
     for (uint32_t i = 0; i < n; i++)
     {
         float height;
@@ -1658,10 +2042,7 @@ TGContainerArray TexGui::Column(TGContainer* c, uint32_t heightCount, const floa
         else
             height = pHeights[i];
 
-        if (i == 0)
-            out.data = createChild(c, {x, y, width, height});
-        else
-            createChild(c, {x, y, width, height});
+        initChild(&out.data[i], c, {x, y, width, height});
 
         y += height + spacing;
     }
@@ -1676,6 +2057,99 @@ TGContainerArray TexGui::Column(TGContainer* c, uint32_t heightCount, const floa
 
 }
 
+// Resolves flex item sizes along one axis. Items start at their basis and share the free space by grow factor.
+// Items that would break their min/max are frozen at it, and the rest of the space is shared out again.
+static void solveFlex(const FlexItem* items, uint32_t n, float available, float* sizes)
+{
+    auto& arena = GTexGui->frameArena;
+    bool* frozen = arena.alloc<bool>(n);
+    float* targets = arena.alloc<float>(n);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        frozen[i] = items[i].Grow <= 0;
+        sizes[i] = fmin(fmax(items[i].Basis, items[i].Min), items[i].Max);
+    }
+
+    for (uint32_t pass = 0; pass < n; pass++)
+    {
+        float free = available;
+        float grow = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            free -= frozen[i] ? sizes[i] : items[i].Basis;
+            if (!frozen[i]) grow += items[i].Grow;
+        }
+        if (grow == 0) break;
+
+        float violation = 0;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (frozen[i]) continue;
+            targets[i] = items[i].Basis + fmax(free, 0) * items[i].Grow / grow;
+            sizes[i] = fmin(fmax(targets[i], items[i].Min), items[i].Max);
+            violation += sizes[i] - targets[i];
+        }
+        if (violation == 0) break;
+
+        // Clamped up means the others need to give space back, clamped down means there is more to give out
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (frozen[i]) continue;
+            if (violation > 0 ? sizes[i] > targets[i] : sizes[i] < targets[i])
+                frozen[i] = true;
+        }
+    }
+}
+
+static TGContainerArray flexCells(TGContainer* c, uint32_t n, const float* sizes, float cross, float spacing, bool row)
+{
+    TGContainerArray out = {GTexGui->frameArena.create<TGContainer>(n), n};
+    float main = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (i != 0) main += spacing;
+        fbox cell = row ? fbox{main, 0, sizes[i], cross} : fbox{0, main, cross, sizes[i]};
+        initChild(&out.data[i], c, cell);
+        main += sizes[i];
+    }
+
+    fbox arranged = Arrange(c, row ? fbox{c->bounds.pos.x, c->bounds.pos.y, main, cross}
+                                   : fbox{c->bounds.pos.x, c->bounds.pos.y, cross, main});
+    for (uint32_t i = 0; i < n; i++)
+    {
+        out[i]->bounds.pos.x += arranged.pos.x;
+        out[i]->bounds.pos.y += arranged.pos.y;
+    }
+    return out;
+}
+
+TGContainerArray TexGui::Row(TGContainer* c, uint32_t itemCount, const FlexItem* pItems, float height, RowStyle* style)
+{
+    if (style == nullptr)
+        style = &GTexGui->styleStack.back()->Row;
+    if (height < 1) {
+        height = height == 0 ? c->bounds.size.height : c->bounds.size.height * height;
+    }
+    float spacing = style->Spacing;
+    float* widths = GTexGui->frameArena.alloc<float>(itemCount);
+    solveFlex(pItems, itemCount, c->bounds.size.width - spacing * fmax(float(itemCount) - 1, 0), widths);
+    return flexCells(c, itemCount, widths, height, spacing, true);
+}
+
+TGContainerArray TexGui::Column(TGContainer* c, uint32_t itemCount, const FlexItem* pItems, float width, ColumnStyle* style)
+{
+    if (style == nullptr)
+        style = &GTexGui->styleStack.back()->Column;
+    if (width < 1) {
+        width = width == 0 ? c->bounds.size.width : c->bounds.size.width * width;
+    }
+    float spacing = style->Spacing;
+    float* heights = GTexGui->frameArena.alloc<float>(itemCount);
+    solveFlex(pItems, itemCount, c->bounds.size.height - spacing * fmax(float(itemCount) - 1, 0), heights);
+    return flexCells(c, itemCount, heights, width, spacing, false);
+}
+
 TGContainerArray TexGui::Row(TGContainer* c, std::initializer_list<float> widths, float height, RowStyle* style)
 {
     return TexGui::Row(c, widths.size(), widths.begin(), height, style);
@@ -1699,94 +2173,84 @@ Math::fbox TexGui::getSize(TGContainer* c)
 
 Texture* IconSheet::getIcon(uint32_t x, uint32_t y)
 {
-    ibox bounds = { int(x * iw), int((y + 1) * ih), int(iw), int(ih) };
-    return &m_custom_texs.emplace_back(glID, bounds, Math::ivec2{w, h}, 0, 0, 0, 0);
+    assert(x < columns && y < rows);
+    return &icons[y * columns + x];
 }
 
 // [RenderData]
 
 bool RenderData::drawTextSelection(const uint16_t* codepointStart, const uint32_t len, TextInputState* textInput, Math::fvec2 textPos, int size)
 {
+    // Inactive inputs don't draw a caret or selection, so there is nothing to hit-test.
+    // The text may change while we aren't looking, so rebuild the glyph positions once it is active again.
+    if (!(textInput->state & STATE_ACTIVE))
+    {
+        textInput->glyphXDirty = true;
+        return false;
+    }
 
     auto& io = inputFrame;
     int& textCursorPos = textInput->textCursorPos;
     Style& style = *GTexGui->styleStack.back();
     Font* font = style.Text.Font;
 
-    float currx = textPos.x;
-    float curry = textPos.y;
-
-    float cursorPosLocation = -1;
-    for (int i = 0; i < len; i++)
+    auto& glyphX = textInput->glyphX;
+    if (textInput->glyphXDirty || textInput->glyphSize != size || glyphX.size() != len + 1)
     {
-        FontGlyph glyph = font->getGlyph(codepointStart[i]);
-        float advance = glyph.advanceX * size;
-        if (textInput->state & STATE_ACTIVE && io.lmb == KEY_Press)
+        glyphX.resize(len + 1);
+        glyphX[0] = 0;
+        for (uint32_t i = 0; i < len; i++)
         {
-            textInput->selection[0] = -1;
-            textInput->selection[1] = -1;
-            if (io.cursorPos.x >= currx && io.cursorPos.x <= currx + advance * 0.5)
-                textCursorPos = i;
-            else if (io.cursorPos.x > currx + advance * 0.5)
-                textCursorPos = i + 1;
+            FontGlyph glyph = font->getGlyph(codepointStart[i]);
+            glyphX[i + 1] = glyphX[i] + glyph.advanceX * size;
         }
+        textInput->glyphSize = size;
+        textInput->glyphXDirty = false;
+    }
 
-        if (textCursorPos == i)
-            cursorPosLocation = currx;
-
-        if (textInput->state & STATE_ACTIVE && io.lmb == KEY_Held)
-        {
-            if (io.cursorPos.x >= currx && io.cursorPos.x <= currx + advance * 0.5)
-            {
-                textInput->selection[i >= textCursorPos ? 0 : 1] = textCursorPos;
-                textInput->selection[i >= textCursorPos ? 1 : 0] = i;
-            }
-            else if (io.cursorPos.x > currx + advance * 0.5)
-            {
-                textInput->selection[i >= textCursorPos ? 0 : 1] = textCursorPos;
-                textInput->selection[i >= textCursorPos ? 1 : 0] = i + 1;
-            }
-        }
-        // If currIdx is within range of the selection
-        if (i >= textInput->selection[0] && i < textInput->selection[1])
-        {
-            addQuad({currx, curry + size / 4.f - size, advance, float(size)}, style.TextInput.SelectColor);
-        }
+    // Index of the glyph boundary under the mouse, rounding to the nearest half of a glyph.
+    // -1 if the mouse is left of the text.
+    int mouseIdx = -1;
+    float mousex = io.cursorPos.x - textPos.x;
+    if (mousex >= 0)
+    {
+        mouseIdx = binarySearch(glyphX, mousex);
+        if (mouseIdx < int(len) && mousex > (glyphX[mouseIdx] + glyphX[mouseIdx + 1]) * 0.5f)
+            mouseIdx++;
+    }
 
-        currx += advance;
+    if (io.lmbPressed())
+    {
+        textInput->selection[0] = -1;
+        textInput->selection[1] = -1;
+        if (mouseIdx != -1)
+            textCursorPos = mouseIdx;
+    }
+    else if (io.lmbHeld() && mouseIdx != -1)
+    {
+        textInput->selection[0] = std::min(textCursorPos, mouseIdx);
+        textInput->selection[1] = std::max(textCursorPos, mouseIdx);
     }
 
-    if (textCursorPos == len)
-        cursorPosLocation = currx;
+    float curry = textPos.y;
 
-    const Math::ivec2& framebufferSize = GTexGui->framebufferSize;
+    // Text inputs are a single line, so the selection is a single rect
+    int selStart = clamp(textInput->selection[0], 0, int(len));
+    int selEnd = clamp(textInput->selection[1], 0, int(len));
+    if (selStart < selEnd)
+    {
+        float x0 = textPos.x + glyphX[selStart];
+        float x1 = textPos.x + glyphX[selEnd];
+        addQuad({x0, curry + size / 4.f - size, x1 - x0, float(size)}, style.TextInput.SelectColor);
+    }
 
-    if (textInput->state & STATE_ACTIVE && cursorPosLocation != -1)
+    if (textCursorPos >= 0 && textCursorPos <= int(len))
     {
+        float cursorPosLocation = textPos.x + glyphX[textCursorPos];
         float cursorY = curry + size / 4.f;
 
-        vertices.emplace_back(Vertex{.pos = {cursorPosLocation, cursorY - size}});
-        vertices.emplace_back(Vertex{.pos = {cursorPosLocation + 2, cursorY - size}});
-        vertices.emplace_back(Vertex{.pos = {cursorPosLocation, cursorY}});
-        vertices.emplace_back(Vertex{.pos = {cursorPosLocation + 2, cursorY}});
-        uint32_t idx = vertices.size() - 4;
-        indices.emplace_back(idx);
-        indices.emplace_back(idx+1);
-        indices.emplace_back(idx+2);
-        indices.emplace_back(idx+1);
-        indices.emplace_back(idx+2);
-        indices.emplace_back(idx+3);
-
-        commands.emplace_back(Command{
-            .type = RD_CMD_Draw,
-            .draw = {
-                .indexCount = 6,
-                .textureIndex = 0,
-                .scaleX = 2.f / float(framebufferSize.x),
-                .scaleY = 2.f / float(framebufferSize.y),
-            }
-        });
-
+        pushQuad({cursorPosLocation, cursorY - size, 2, float(size)}, {0, 0, 0, 0}, {0, 0}, 0xFFFFFFFF);
+        addDraw(0, {0, 0}, RD_SHADE_Flat);
     }
 
     return false;
@@ -1830,9 +2294,7 @@ void RenderData::addText(const uint16_t* codepointStart, const uint32_t len, Tex
     if (textInput)
         drawTextSelection(codepointStart, len, textInput, pos, pixelSize);
 
-    const Math::ivec2& framebufferSize = GTexGui->framebufferSize;
-
-    uint32_t nChars = 0;
+    Math::fvec2 uvScale = {1.f / float(font->atlasTexture->bounds.size.width), 1.f / float(font->atlasTexture->bounds.size.height)};
 
     float lineGap = ceil(font->getLineGap(pixelSize)); 
 
@@ -1858,36 +2320,25 @@ void RenderData::addText(const uint16_t* codepointStart, const uint32_t len, Tex
             float x1 = currx + glyph.X1 * pixelSize;
             float y1 = curry + glyph.Y1 * pixelSize;
 
-            vertices.emplace_back(Vertex{.pos = {x0, y0}, .uv = {glyph.U0, glyph.V0}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {x1, y0}, .uv = {glyph.U1, glyph.V0}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {x0, y1}, .uv = {glyph.U0, glyph.V1}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {x1, y1}, .uv = {glyph.U1, glyph.V1}, .col = col});
-            uint32_t idx = vertices.size() - 4;
-
-            indices.emplace_back(idx);
-            indices.emplace_back(idx+1);
-            indices.emplace_back(idx+2);
-            indices.emplace_back(idx+1);
-            indices.emplace_back(idx+2);
-            indices.emplace_back(idx+3);
-
-            nChars++;
+            pushQuad({x0, y0, x1 - x0, y1 - y0}, {glyph.U0, glyph.V0, glyph.U1 - glyph.U0, glyph.V1 - glyph.V0}, uvScale, col);
         }
 
         currx += advance;
     }
 
-    commands.emplace_back(Command{
-        .type = RD_CMD_Draw,
-        .draw = {
-            .indexCount = 6 * nChars,
-            .textureIndex = font->atlasTexture->id,
-            .scaleX = 2.f / float(framebufferSize.x),
-            .scaleY = 2.f / float(framebufferSize.y),
-            .uvScaleX = 1.f / float(font->atlasTexture->bounds.size.width),
-            .uvScaleY = 1.f / float(font->atlasTexture->bounds.size.height),
-        }
-    });
+    if (font->msdfPxRange <= 0)
+    {
+        addDraw(font->atlasTexture->id, uvScale);
+        return;
+    }
+
+    Command* draw = addDraw(font->atlasTexture->id, uvScale, font->outlineColor ? RD_SHADE_MsdfOutline : RD_SHADE_Msdf);
+    if (draw)
+    {
+        // the atlas range scaled to the size the glyphs are drawn at
+        draw->draw.pxRange = std::max(font->msdfPxRange * pixelSize / font->pixelSize, 1.f);
+        draw->draw.outlineColor = font->outlineColor;
+    }
 }
 
 static inline uint32_t getTextureIndexFromState(Texture* e, int state)
@@ -1903,26 +2354,33 @@ void RenderData::pushScissor(Math::fbox region)
     region.pos.y *= GTexGui->scale;
     region.size.width *= GTexGui->scale;
     region.size.height *= GTexGui->scale;
-    commands.emplace_back(Command{
-        .type = RD_CMD_Scissor,
-        .scissor = {
-            .push = true,
-            .x = int(region.pos.x),
-            .y = int(region.pos.y),
-            .width = int(region.size.width),
-            .height = int(region.size.height),
-        }
-    });
+    if (!clipStack.empty())
+        region = fbox::intersect(region, clipStack.back().rect);
+
+    clipStack.push_back({region, 0});
 }
 
 void RenderData::popScissor()
 {
-    commands.emplace_back(Command{
-        .type = RD_CMD_Scissor,
-        .scissor = {
-            .push = false,
-        }
-    });
+    if (clipStack.empty()) return;
+    clipStack.pop_back();
+}
+
+int32_t RenderData::clipIndex(const Math::fbox& bounds)
+{
+    if (clipStack.empty()) return 0;
+
+    Clip& clip = clipStack.back();
+    if (!fbox::intersect(bounds, clip.rect).isValid()) return -1;
+    if (clip.rect.encloses(bounds)) return 0;
+
+    // Only the innermost rect is needed, it is already intersected with the outer ones
+    if (clip.index == 0)
+    {
+        clipRects.push_back(clip.rect);
+        clip.index = clipRects.size();
+    }
+    return clip.index;
 }
 
 void RenderData::addTexture(fbox rect, Texture* e, int state, int pixel_size, uint32_t flags, uint32_t col)
@@ -1932,9 +2390,7 @@ void RenderData::addTexture(fbox rect, Texture* e, int state, int pixel_size, ui
     col |= alphaModifier;
 
     uint32_t tex = getTextureIndexFromState(e, state);
-
-    auto& g = *GTexGui;
-    Math::ivec2 framebufferSize = g.framebufferSize;
+    Math::fvec2 uvScale = {1.f / float(e->size.x), 1.f / float(e->size.y)};
 
     rect.pos.x *= GTexGui->scale;
     rect.pos.y *= GTexGui->scale;
@@ -1943,28 +2399,35 @@ void RenderData::addTexture(fbox rect, Texture* e, int state, int pixel_size, ui
     Math::fbox texBounds = intToFloatBox(e->bounds);
     if (!(flags & SLICE_9))
     {
+        pushQuad(rect, texBounds, uvScale, col);
+        addDraw(tex, uvScale);
+        return;
+    }
 
-        vertices.emplace_back(Vertex{.pos = {rect.pos.x, rect.pos.y}, .uv = {texBounds.pos.x, texBounds.pos.y}, .col = col});
-        vertices.emplace_back(Vertex{.pos = {rect.pos.x + rect.size.width, rect.pos.y}, .uv = {texBounds.pos.x + texBounds.size.width, texBounds.pos.y}, .col = col});
-        vertices.emplace_back(Vertex{.pos = {rect.pos.x, rect.pos.y + rect.size.height}, .uv = {texBounds.pos.x, texBounds.pos.y + texBounds.size.height}, .col = col});
-        vertices.emplace_back(Vertex{.pos = {rect.pos.x + rect.size.width, rect.pos.y + rect.size.height}, .uv = {texBounds.pos.x + texBounds.size.width, texBounds.pos.y + texBounds.size.height}, .col = col});
-        uint32_t idx = vertices.size() - 4;
-        indices.emplace_back(idx);
-        indices.emplace_back(idx+1);
-        indices.emplace_back(idx+2);
-        indices.emplace_back(idx+1);
-        indices.emplace_back(idx+2);
-        indices.emplace_back(idx+3);
-
+    // The renderer cuts the slices from a single quad
+    if (GTexGui->instancedQuads)
+    {
+        int32_t clip = clipIndex(rect);
+        if (clip < 0) return;
+        emitQuad(rect, texBounds, uvScale, col);
         commands.emplace_back(Command{
-            .type = RD_CMD_Draw,
+            .type = RD_CMD_DrawSlices,
             .draw = {
-                .indexCount = 6,
+                .count = 1,
                 .textureIndex = tex,
-                .scaleX = 2.f / float(framebufferSize.x),
-                .scaleY = 2.f / float(framebufferSize.y),
-                .uvScaleX = 1.f / float(e->size.x),
-                .uvScaleY = 1.f / float(e->size.y),
+                .scaleX = 2.f / float(GTexGui->framebufferSize.x),
+                .scaleY = 2.f / float(GTexGui->framebufferSize.y),
+                .uvScaleX = uvScale.x,
+                .uvScaleY = uvScale.y,
+                .border = {
+                    flags & SLICE_3_HORIZONTAL ? e->left : 0,
+                    flags & SLICE_3_VERTICAL ? e->top : 0,
+                    flags & SLICE_3_HORIZONTAL ? e->right : 0,
+                    flags & SLICE_3_VERTICAL ? e->bottom : 0,
+                },
+                .borderScale = float(pixel_size),
+                .clipIndex = uint32_t(clip),
+                .shading = RD_SHADE_Textured,
             }
         });
         return;
@@ -2020,67 +2483,304 @@ void RenderData::addTexture(fbox rect, Texture* e, int state, int pixel_size, ui
                 texBounds.size.height = texBoundsSliceV[y][1];
             }
 
-            vertices.emplace_back(Vertex{.pos = {slice.pos.x, slice.pos.y}, .uv = {texBounds.pos.x, texBounds.pos.y}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {slice.pos.x + slice.size.width, slice.pos.y}, .uv = {texBounds.pos.x + texBounds.size.width, texBounds.pos.y}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {slice.pos.x, slice.pos.y + slice.size.height}, .uv = {texBounds.pos.x, texBounds.pos.y + texBounds.size.height}, .col = col});
-            vertices.emplace_back(Vertex{.pos = {slice.pos.x + slice.size.width, slice.pos.y + slice.size.height}, .uv = {texBounds.pos.x + texBounds.size.width, texBounds.pos.y + texBounds.size.height}, .col = col});
-            uint32_t idx = vertices.size() - 4;
-            indices.emplace_back(idx);
-            indices.emplace_back(idx+1);
-            indices.emplace_back(idx+2);
-            indices.emplace_back(idx+1);
-            indices.emplace_back(idx+2);
-            indices.emplace_back(idx+3);
+            pushQuad(slice, texBounds, uvScale, col);
         }
     }
 
-    commands.emplace_back(Command{
-            .type = RD_CMD_Draw,
-            .draw = {
-                .indexCount = uint32_t(6 * (flags & SLICE_3_HORIZONTAL ? 3 : 1) * (flags & SLICE_3_VERTICAL ? 3 : 1)),
-                .textureIndex = tex,
-                .scaleX = 2.f / float(framebufferSize.x),
-                .scaleY = 2.f / float(framebufferSize.y),
-                .uvScaleX = 1.f / float(e->size.x),
-                .uvScaleY = 1.f / float(e->size.y),
-            }
-    });
+    addDraw(tex, uvScale);
 }
 
 void RenderData::addQuad(Math::fbox rect, uint32_t col)
 {
     col &= ~(ALPHA_MASK);
     col |= alphaModifier;
-    Math::ivec2 framebufferSize = GTexGui->framebufferSize;
 
     rect.pos.x *= GTexGui->scale;
     rect.pos.y *= GTexGui->scale;
     rect.size.width *= GTexGui->scale;
     rect.size.height *= GTexGui->scale;
 
-    vertices.emplace_back(Vertex{.pos = {rect.pos.x, rect.pos.y}, .uv = {0,0}, .col = col,});
-    vertices.emplace_back(Vertex{.pos = {rect.pos.x + rect.size.width, rect.pos.y}, .uv = {0, 0}, .col = col,});
-    vertices.emplace_back(Vertex{.pos = {rect.pos.x, rect.pos.y + rect.size.height}, .uv = {0, 0}, .col = col,});
-    vertices.emplace_back(Vertex{.pos = {rect.pos.x + rect.size.width, rect.pos.y + rect.size.height}, .uv = {0, 0}, .col = col,});
-    uint32_t idx = vertices.size() - 4;
-    indices.emplace_back(idx);
-    indices.emplace_back(idx+1);
-    indices.emplace_back(idx+2);
-    indices.emplace_back(idx+1);
-    indices.emplace_back(idx+2);
-    indices.emplace_back(idx+3);
+    pushQuad(rect, {0, 0, 0, 0}, {0, 0}, col);
+    addDraw(0, {0, 0}, RD_SHADE_Flat);
+}
 
-    commands.emplace_back(Command{
-        .type = RD_CMD_Draw,
+void RenderData::pushQuad(Math::fbox rect, Math::fbox uv, Math::fvec2 uvScale, uint32_t col)
+{
+    if (!clipStack.empty())
+    {
+        fbox clipped = fbox::intersect(rect, clipStack.back().rect);
+        if (!clipped.isValid()) return;
+
+        // cut the uvs by the same fraction as the rect
+        if (clipped.size.width != rect.size.width || clipped.size.height != rect.size.height)
+        {
+            float uPerPx = uv.size.width / rect.size.width;
+            float vPerPx = uv.size.height / rect.size.height;
+            uv.pos.x += (clipped.pos.x - rect.pos.x) * uPerPx;
+            uv.pos.y += (clipped.pos.y - rect.pos.y) * vPerPx;
+            uv.size.width = clipped.size.width * uPerPx;
+            uv.size.height = clipped.size.height * vPerPx;
+            rect = clipped;
+        }
+    }
+    pendingQuads++;
+    emitQuad(rect, uv, uvScale, col);
+}
+
+void RenderData::emitQuad(const Math::fbox& rect, const Math::fbox& uv, Math::fvec2 uvScale, uint32_t col)
+{
+    if (GTexGui->instancedQuads)
+    {
+        auto unorm = [](float x) { return uint16_t(Math::clamp(x, 0.f, 1.f) * 65535.f + 0.5f); };
+        quads.push_back(Quad{
+            .pos = rect.pos,
+            .size = rect.size,
+            .uv = {
+                unorm(uv.pos.x * uvScale.x),
+                unorm(uv.pos.y * uvScale.y),
+                unorm((uv.pos.x + uv.size.width) * uvScale.x),
+                unorm((uv.pos.y + uv.size.height) * uvScale.y),
+            },
+            .col = col,
+        });
+        return;
+    }
+
+    pushVertex({rect.pos.x, rect.pos.y}, {uv.pos.x, uv.pos.y}, col);
+    pushVertex({rect.pos.x + rect.size.width, rect.pos.y}, {uv.pos.x + uv.size.width, uv.pos.y}, col);
+    pushVertex({rect.pos.x, rect.pos.y + rect.size.height}, {uv.pos.x, uv.pos.y + uv.size.height}, col);
+    pushVertex({rect.pos.x + rect.size.width, rect.pos.y + rect.size.height}, {uv.pos.x + uv.size.width, uv.pos.y + uv.size.height}, col);
+}
+
+void RenderData::pushVertex(Math::fvec2 pos, Math::fvec2 uv, uint32_t col)
+{
+    if (!GTexGui->compactVertices)
+    {
+        vertices.emplace_back(Vertex{.pos = pos, .uv = uv, .col = col});
+        return;
+    }
+
+    auto fixed = [](float x, float lo, float hi) { return Math::clamp(roundf(x * TEXGUI_VERTEX_SUBPIXEL), lo, hi); };
+    compactVertices.emplace_back(CompactVertex{
+        .pos = {int16_t(fixed(pos.x, -32767, 32767)), int16_t(fixed(pos.y, -32767, 32767))},
+        .uv = {uint16_t(fixed(uv.x, 0, 65535)), uint16_t(fixed(uv.y, 0, 65535))},
+        .col = col,
+    });
+}
+
+RenderData::Command* RenderData::addDraw(uint32_t textureIndex, Math::fvec2 uvScale, RenderDataShading shading)
+{
+    uint32_t quadCount = pendingQuads;
+    pendingQuads = 0;
+    if (quadCount == 0) return nullptr;
+    const Math::ivec2& framebufferSize = GTexGui->framebufferSize;
+    bool instanced = GTexGui->instancedQuads;
+
+    return &commands.emplace_back(Command{
+        .type = instanced ? RD_CMD_DrawQuads : RD_CMD_Draw,
         .draw = {
-            .indexCount = 6,
-            .textureIndex = 0,
+            .count = quadCount,
+            .textureIndex = textureIndex,
             .scaleX = 2.f / float(framebufferSize.x),
             .scaleY = 2.f / float(framebufferSize.y),
+            .uvScaleX = uvScale.x,
+            .uvScaleY = uvScale.y,
+            .shading = shading,
         }
     });
 }
 
+bool RenderData::canMerge(const Command& a, const Command& b)
+{
+    if (a.type != b.type || a.type == RD_CMD_Scissor || a.type == RD_CMD_None) return false;
+
+    const auto& x = a.draw;
+    const auto& y = b.draw;
+    if (x.textureIndex != y.textureIndex || x.clipIndex != y.clipIndex || x.shading != y.shading ||
+        x.pxRange != y.pxRange || x.outlineColor != y.outlineColor ||
+        x.scaleX != y.scaleX || x.scaleY != y.scaleY ||
+        x.translateX != y.translateX || x.translateY != y.translateY)
+        return false;
+
+    // instanced quads have their uvs normalised already
+    if (a.type == RD_CMD_DrawQuads) return true;
+    if (x.uvScaleX != y.uvScaleX || x.uvScaleY != y.uvScaleY) return false;
+    return a.type == RD_CMD_Draw ||
+        (x.borderScale == y.borderScale && memcmp(x.border, y.border, sizeof(x.border)) == 0);
+}
+
+// Scratch for sortDraws, kept between frames
+static std::vector<Math::fbox> drawBounds;
+static std::vector<uint32_t> drawFirst;
+static std::vector<uint32_t> drawNext;
+// Up to SORT_DRAWS_CHUNK consecutive draws of a batch, with the union of their bounds
+struct DrawChunk
+{
+    Math::fbox bounds;
+    uint32_t head; // first draw, the rest follow through drawNext
+    uint32_t count;
+    uint32_t next; // next chunk of the batch
+};
+static std::vector<DrawChunk> drawChunks;
+struct DrawBatch
+{
+    uint32_t head, tail; // commands in the batch, linked through drawNext
+    uint32_t firstChunk, lastChunk;
+    Math::fbox bounds; // union of the batch's draw bounds
+};
+static std::vector<DrawBatch> drawBatches;
+
+// How many batches a draw is moved back past at most
+#define SORT_DRAWS_LOOKBACK 64
+// Draws per chunk. A draw moving back past a batch only tests the draws of the chunks whose bounds it hits.
+#define SORT_DRAWS_CHUNK 16
+// How many chunks of a batch are tested at most, larger batches whose bounds are hit are treated as overlapping
+#define SORT_DRAWS_CHUNK_SCAN 64
+
+static Math::fbox unite(const Math::fbox& a, const Math::fbox& b)
+{
+    if (!b.isValid()) return a;
+    if (!a.isValid()) return b;
+    float x0 = std::min(a.pos.x, b.pos.x);
+    float y0 = std::min(a.pos.y, b.pos.y);
+    float x1 = std::max(a.pos.x + a.size.width, b.pos.x + b.size.width);
+    float y1 = std::max(a.pos.y + a.size.height, b.pos.y + b.size.height);
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+static bool isDraw(const RenderData::Command& c)
+{
+    return c.type == RD_CMD_Draw || c.type == RD_CMD_DrawQuads || c.type == RD_CMD_DrawSlices;
+}
+
+void RenderData::sortDraws(std::vector<DrawRef>& out) const
+{
+    out.clear();
+    drawBounds.resize(commands.size());
+    drawFirst.resize(commands.size());
+    drawNext.assign(commands.size(), UINT32_MAX);
+    drawChunks.clear();
+    drawBatches.clear();
+
+    // Where each draw's quads start, and what they cover
+    uint32_t currVertexQuad = 0;
+    uint32_t currQuad = 0;
+    for (uint32_t i = 0; i < commands.size(); i++)
+    {
+        const Command& c = commands[i];
+        if (!isDraw(c)) continue;
+
+        float x0 = FLT_MAX, y0 = FLT_MAX, x1 = -FLT_MAX, y1 = -FLT_MAX;
+        if (c.type == RD_CMD_Draw)
+        {
+            drawFirst[i] = currVertexQuad;
+            for (uint32_t v = currVertexQuad * 4; v < (currVertexQuad + c.draw.count) * 4; v++)
+            {
+                float x, y;
+                if (GTexGui->compactVertices)
+                {
+                    x = compactVertices[v].pos[0] / float(TEXGUI_VERTEX_SUBPIXEL);
+                    y = compactVertices[v].pos[1] / float(TEXGUI_VERTEX_SUBPIXEL);
+                }
+                else
+                {
+                    x = vertices[v].pos.x;
+                    y = vertices[v].pos.y;
+                }
+                x0 = std::min(x0, x); y0 = std::min(y0, y);
+                x1 = std::max(x1, x); y1 = std::max(y1, y);
+            }
+            currVertexQuad += c.draw.count;
+        }
+        else
+        {
+            drawFirst[i] = currQuad;
+            for (uint32_t q = currQuad; q < currQuad + c.draw.count; q++)
+            {
+                const Quad& quad = quads[q];
+                x0 = std::min(x0, quad.pos.x); y0 = std::min(y0, quad.pos.y);
+                x1 = std::max(x1, quad.pos.x + quad.size.width); y1 = std::max(y1, quad.pos.y + quad.size.height);
+            }
+            currQuad += c.draw.count;
+        }
+
+        drawBounds[i] = {x0, y0, x1 - x0, y1 - y0};
+        if (c.draw.clipIndex > 0)
+            drawBounds[i] = fbox::intersect(drawBounds[i], clipRects[c.draw.clipIndex - 1]);
+    }
+
+    // Anything that isn't a draw stays where it is, nothing is moved past it
+    int32_t start = 0;
+    for (uint32_t i = 0; i < commands.size(); i++)
+    {
+        const Command& c = commands[i];
+        if (!isDraw(c))
+        {
+            drawBatches.push_back({i, i, UINT32_MAX, UINT32_MAX, {}});
+            start = drawBatches.size();
+            continue;
+        }
+
+        int32_t target = -1;
+        int32_t stop = std::max(start, int32_t(drawBatches.size()) - SORT_DRAWS_LOOKBACK);
+        for (int32_t b = int32_t(drawBatches.size()) - 1; b >= stop; b--)
+        {
+            const DrawBatch& batch = drawBatches[b];
+            if (canMerge(commands[batch.head], c))
+            {
+                target = b;
+                break;
+            }
+
+            // can't be moved under anything it covers. The bounds of the batch, then of its chunks,
+            // reject most of it without testing every draw.
+            if (!fbox::intersect(batch.bounds, drawBounds[i]).isValid()) continue;
+            bool overlaps = false;
+            uint32_t scanned = 0;
+            for (uint32_t ch = batch.firstChunk; ch != UINT32_MAX && !overlaps; ch = drawChunks[ch].next)
+            {
+                const DrawChunk& chunk = drawChunks[ch];
+                if (++scanned > SORT_DRAWS_CHUNK_SCAN)
+                {
+                    overlaps = true;
+                    break;
+                }
+                if (!fbox::intersect(chunk.bounds, drawBounds[i]).isValid()) continue;
+                uint32_t d = chunk.head;
+                for (uint32_t n = 0; n < chunk.count && !overlaps; n++, d = drawNext[d])
+                    overlaps = fbox::intersect(drawBounds[d], drawBounds[i]).isValid();
+            }
+            if (overlaps) break;
+        }
+
+        if (target < 0)
+        {
+            drawChunks.push_back({drawBounds[i], i, 1, UINT32_MAX});
+            uint32_t ch = drawChunks.size() - 1;
+            drawBatches.push_back({i, i, ch, ch, drawBounds[i]});
+            continue;
+        }
+        DrawBatch& batch = drawBatches[target];
+        drawNext[batch.tail] = i;
+        batch.tail = i;
+        batch.bounds = unite(batch.bounds, drawBounds[i]);
+        if (drawChunks[batch.lastChunk].count == SORT_DRAWS_CHUNK)
+        {
+            drawChunks.push_back({{}, i, 0, UINT32_MAX});
+            drawChunks[batch.lastChunk].next = drawChunks.size() - 1;
+            batch.lastChunk = drawChunks.size() - 1;
+        }
+        DrawChunk& chunk = drawChunks[batch.lastChunk];
+        chunk.count++;
+        chunk.bounds = unite(chunk.bounds, drawBounds[i]);
+    }
+
+    out.reserve(commands.size());
+    for (const DrawBatch& batch : drawBatches)
+        for (uint32_t d = batch.head; d != UINT32_MAX; d = drawNext[d])
+            out.push_back({d, isDraw(commands[d]) ? drawFirst[d] : 0});
+}
+
 // from imgui
 #define IM_NORMALIZE2F_OVER_ZERO(VX,VY)     { float d2 = VX*VX + VY*VY; if (d2 > 0.0f) { float inv_len = 1.0/sqrt(d2); VX *= inv_len; VY *= inv_len; } } (void)0
 
@@ -2106,26 +2806,26 @@ void RenderData::addLine(float x1, float y1, float x2, float y2, uint32_t col, f
     dx *= (lineWidth * 0.5f);
     dy *= (lineWidth * 0.5f);
 
-    vertices.emplace_back(Vertex{.pos = {x1 + dy, y1 - dx}, .uv = {0,0}, .col = col});
-    vertices.emplace_back(Vertex{.pos = {x2 + dy, y2 - dx}, .uv = {0,0}, .col = col,});
-    vertices.emplace_back(Vertex{.pos = {x2 - dy, y2 + dx}, .uv = {0,0}, .col = col,});
-    vertices.emplace_back(Vertex{.pos = {x1 - dy, y1 + dx}, .uv = {0,0}, .col = col,});
+    float minX = std::min(x1, x2) - fabsf(dy), maxX = std::max(x1, x2) + fabsf(dy);
+    float minY = std::min(y1, y2) - fabsf(dx), maxY = std::max(y1, y2) + fabsf(dx);
+    int32_t clip = clipIndex({minX, minY, maxX - minX, maxY - minY});
+    if (clip < 0) return;
 
-    uint32_t idx = vertices.size() - 4;
-    indices.emplace_back(idx);
-    indices.emplace_back(idx+1);
-    indices.emplace_back(idx+2);
-    indices.emplace_back(idx);
-    indices.emplace_back(idx+2);
-    indices.emplace_back(idx+3);
+    // ordered to use the same indices as a quad
+    pushVertex({x1 + dy, y1 - dx}, {0, 0}, col);
+    pushVertex({x2 + dy, y2 - dx}, {0, 0}, col);
+    pushVertex({x1 - dy, y1 + dx}, {0, 0}, col);
+    pushVertex({x2 - dy, y2 + dx}, {0, 0}, col);
 
     commands.emplace_back(Command{
         .type = RD_CMD_Draw,
         .draw = {
-            .indexCount = 6,
+            .count = 1,
             .textureIndex = 0,
             .scaleX = 2.f / float(framebufferSize.x),
             .scaleY = 2.f / float(framebufferSize.y),
+            .clipIndex = uint32_t(clip),
+            .shading = RD_SHADE_Flat,
         }
     });
 }
@@ -2134,21 +2834,60 @@ void RenderData::addLine(float x1, float y1, float x2, float y2, uint32_t col, f
 
 Style* TexGui::BeginStyle()
 {
-    Style* style = new Style;
-    if (!GTexGui->styleStack.empty())
+    auto& g = *GTexGui;
+    if (g.styleStack.size() == g.stylePool.size())
+        g.stylePool.emplace_back();
+
+    Style* style = &g.stylePool[g.styleStack.size()];
+    if (!g.styleStack.empty())
     {
-        *style = *GTexGui->styleStack.back();
+        *style = *g.styleStack.back();
     };
-    GTexGui->styleStack.push_back(style);
+    g.styleStack.push_back(style);
     return style;
 }
 
 void TexGui::EndStyle()
 {
-    delete GTexGui->styleStack.back();
     GTexGui->styleStack.pop_back();
 }
 
+Style* TexGui::getStyle()
+{
+    return GTexGui->styleStack.back();
+}
+
+void TexGui::pushStyleOverride(size_t offset, const void* value, size_t size)
+{
+    auto& g = *GTexGui;
+    bool ownsStyle = g.styleStack.back() == g.defaultStyle;
+    if (ownsStyle)
+        BeginStyle();
+
+    void* field = (uint8_t*)g.styleStack.back() + offset;
+    uint32_t dataOffset = g.styleOverrideData.size();
+    g.styleOverrideData.resize(dataOffset + size);
+    memcpy(&g.styleOverrideData[dataOffset], field, size);
+    g.styleOverrides.push_back({field, uint32_t(size), dataOffset, ownsStyle});
+    memcpy(field, value, size);
+}
+
+void TexGui::PopStyle(int count)
+{
+    auto& g = *GTexGui;
+    assert(count >= 0 && size_t(count) <= g.styleOverrides.size());
+    for (; count > 0; count--)
+    {
+        auto& o = g.styleOverrides.back();
+        if (o.ownsStyle)
+            EndStyle();
+        else
+            memcpy(o.field, &g.styleOverrideData[o.offset], o.size);
+        g.styleOverrideData.resize(o.offset);
+        g.styleOverrides.pop_back();
+    }
+}
+
 Style* initDefaultStyle()
 {
     auto style = BeginStyle();
@@ -172,6 +172,26 @@ struct ImplGlfw_Data
 
 GLFWmonitorfun TexGui_ImplGlfw_MonitorCallback; 
 
+// GLFW doesn't tell left and right modifiers apart
+static int TexGui_ImplGlfw_ModsToTexGuiMod(int glfwMods)
+{
+    int mod = 0;
+    if (glfwMods & GLFW_MOD_SHIFT)
+        mod |= TexGuiMod_LeftShift;
+    if (glfwMods & GLFW_MOD_CONTROL)
+        mod |= TexGuiMod_LeftCtrl;
+    if (glfwMods & GLFW_MOD_ALT)
+        mod |= TexGuiMod_LeftAlt;
+    if (glfwMods & GLFW_MOD_SUPER)
+        mod |= TexGuiMod_LeftSuper;
+    if (glfwMods & GLFW_MOD_CAPS_LOCK)
+        mod |= TexGuiMod_Caps;
+    if (glfwMods & GLFW_MOD_NUM_LOCK)
+        mod |= TexGuiMod_Num;
+
+    return mod;
+}
+
 void TexGui_ImplGlfw_ScrollCallback(GLFWwindow* window, double xoffset, double yoffset)
 {
     auto& bd = *(ImplGlfw_Data*)GTexGui->backendData;
@@ -179,8 +199,7 @@ void TexGui_ImplGlfw_ScrollCallback(GLFWwindow* window, double xoffset, double y
     if (bd.PrevUserCallbackScroll)
         bd.PrevUserCallbackScroll(window, xoffset, yoffset);
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
-    io.scroll += Math::fvec2(xoffset, yoffset);
+    io.submitScroll({float(xoffset), float(yoffset)});
 }
 
 void TexGui_ImplGlfw_CursorPosCallback(GLFWwindow* window, double x, double y)
@@ -193,13 +212,13 @@ void TexGui_ImplGlfw_CursorPosCallback(GLFWwindow* window, double x, double y)
     x *= GTexGui->contentScale;
     y *= GTexGui->contentScale;
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
+    Math::fvec2 relative = {0, 0};
     if (!io.firstMouse)
         io.firstMouse = true;
     else
-        io.mouseRelativeMotion += Math::fvec2(x - io.cursorPos.x, y - io.cursorPos.y);
+        relative = {float(x - io.cursorPos.x), float(y - io.cursorPos.y)};
 
-    io.cursorPos = Math::fvec2(x, y);
+    io.submitMouseMotion({float(x), float(y)}, relative);
 }
 
 void TexGui_ImplGlfw_KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -209,12 +228,8 @@ void TexGui_ImplGlfw_KeyCallback(GLFWwindow* window, int key, int scancode, int
     if (bd.PrevUserCallbackKey)
         bd.PrevUserCallbackKey(window, key, scancode, action, mods);
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
     TexGuiKey tgkey = TexGui_ImplGlfw_KeyToTexGuiKey(key, scancode);
-    //#TODO: probly dont need to check if keystate is off
-    if (action == GLFW_RELEASE) io.submitKey(tgkey, KEY_Release);
-    else if (io.getKeyState(tgkey) == KEY_Off) io.submitKey(tgkey, KEY_Press);
-    else if (action == GLFW_REPEAT) io.submitKey(tgkey, KEY_Repeat);
+    io.submitKey(tgkey, action != GLFW_RELEASE, action == GLFW_REPEAT, TexGui_ImplGlfw_ModsToTexGuiMod(mods));
 }
 
 void TexGui_ImplGlfw_MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
@@ -225,9 +240,7 @@ void TexGui_ImplGlfw_MouseButtonCallback(GLFWwindow* window, int button, int act
     if (bd.PrevUserCallbackMousebutton)
         bd.PrevUserCallbackMousebutton(window, button, action, mods);
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
-    if (action == GLFW_RELEASE) io.submitMouseButton(button + 1, KEY_Release);
-    else if (io.getMouseButtonState(button + 1) == KEY_Off) io.submitMouseButton(button + 1, KEY_Press);
+    io.submitMouseButton(button + 1, action != GLFW_RELEASE);
 };
 
 void TexGui_ImplGlfw_CharCallback(GLFWwindow* window, unsigned int codepoint)
@@ -238,8 +251,29 @@ void TexGui_ImplGlfw_CharCallback(GLFWwindow* window, unsigned int codepoint)
     if (bd.PrevUserCallbackChar)
         bd.PrevUserCallbackChar(window, codepoint);
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
-    io.charQueue.push(codepoint);
+    // encode the codepoint as utf8
+    char utf8[5] = {};
+    if (codepoint < 0x80)
+        utf8[0] = codepoint;
+    else if (codepoint < 0x800)
+    {
+        utf8[0] = 0xC0 | (codepoint >> 6);
+        utf8[1] = 0x80 | (codepoint & 0x3F);
+    }
+    else if (codepoint < 0x10000)
+    {
+        utf8[0] = 0xE0 | (codepoint >> 12);
+        utf8[1] = 0x80 | ((codepoint >> 6) & 0x3F);
+        utf8[2] = 0x80 | (codepoint & 0x3F);
+    }
+    else
+    {
+        utf8[0] = 0xF0 | (codepoint >> 18);
+        utf8[1] = 0x80 | ((codepoint >> 12) & 0x3F);
+        utf8[2] = 0x80 | ((codepoint >> 6) & 0x3F);
+        utf8[3] = 0x80 | (codepoint & 0x3F);
+    }
+    io.submitText(utf8);
 };
 
 void TexGui_ImplGlfw_FramebufferSizeCallback(GLFWwindow* window, int width, int height)
@@ -253,7 +287,6 @@ void TexGui_ImplGlfw_FramebufferSizeCallback(GLFWwindow* window, int width, int
 
     glfwGetWindowContentScale(window, &GTexGui->contentScale, nullptr);
 
-    std::lock_guard<std::mutex> lock(TGInputLock);
     Base.bounds.size = Math::fvec2(width, height);
 };
 
@@ -235,8 +235,7 @@ bool TexGui::initSDL3(SDL_Window* window)
     return true;
 }
 
-//text is submitted into input frame via a char* queue
-//#TODO if we exceed TEXGUI_TEXT_BUF_SIZE characters we die but 1000000 should be good enough for now
+//text is submitted to the input queue in small chunks, if the queue is full the rest is dropped
 
 //only copying and pasting text is supported
 //we have to call sdl functions on main thread so this is why it is here
@@ -245,9 +244,7 @@ static inline void submit_clipboard()
 {
     auto& io = GTexGui->io;
     char* clipboard = SDL_GetClipboardText();
-    TGInputLock.lock();
-    strcat(io.text, clipboard);
-    TGInputLock.unlock();
+    io.submitText(clipboard);
     SDL_free(clipboard);
 }
 
@@ -263,7 +260,6 @@ void TexGui::processEvent_SDL3(const SDL_Event& event)
     auto& io = GTexGui->io;
     TexGuiKey tgkey;
 
-    //#TODO: text input
     switch (event.type)
     {
         case SDL_EVENT_KEY_DOWN:
@@ -276,22 +272,12 @@ void TexGui::processEvent_SDL3(const SDL_Event& event)
             )
                 submit_clipboard();
 
-            TGInputLock.lock();
-            io.mods = TexGui_ImplSDL3_ModToTexGuiMod(event.key.mod);
-            TGInputLock.unlock();
             tgkey = TexGui_ImplSDL3_KeyEventToTexGuiKey(event.key.key, event.key.scancode);
-
-            TGInputLock.lock();
-            if (io.getKeyState(tgkey) == KEY_Off) io.submitKey(tgkey, KEY_Press);
-            else if (event.key.repeat) io.submitKey(tgkey, KEY_Repeat);
-            TGInputLock.unlock();
+            io.submitKey(tgkey, true, event.key.repeat, TexGui_ImplSDL3_ModToTexGuiMod(event.key.mod));
             break;
         case SDL_EVENT_KEY_UP:
             tgkey = TexGui_ImplSDL3_KeyEventToTexGuiKey(event.key.key, event.key.scancode);
-            TGInputLock.lock();
-            io.mods = TexGui_ImplSDL3_ModToTexGuiMod(event.key.mod);
-            io.submitKey(tgkey, KEY_Release);
-            TGInputLock.unlock();
+            io.submitKey(tgkey, false, false, TexGui_ImplSDL3_ModToTexGuiMod(event.key.mod));
             break;
         case SDL_EVENT_MOUSE_BUTTON_DOWN:
             #ifdef __linux__
@@ -299,35 +285,20 @@ void TexGui::processEvent_SDL3(const SDL_Event& event)
                 submit_clipboard();
             #endif
 
-            TGInputLock.lock();
-            io.submitMouseButton(event.button.button, KEY_Press);
-            TGInputLock.unlock();
+            io.submitMouseButton(event.button.button, true);
             break;
         case SDL_EVENT_MOUSE_BUTTON_UP:
-            TGInputLock.lock();
-            io.submitMouseButton(event.button.button, KEY_Release);
-            TGInputLock.unlock();
+            io.submitMouseButton(event.button.button, false);
             break;
         case SDL_EVENT_MOUSE_WHEEL:
-            TGInputLock.lock();
-            io.scroll.x += event.wheel.x * 25;
-            io.scroll.y += event.wheel.y * 25;
-            TGInputLock.unlock();
+            io.submitScroll({event.wheel.x * 25, event.wheel.y * 25});
             break;
         case SDL_EVENT_MOUSE_MOTION:
-            TGInputLock.lock();
-            io.cursorPos.x = event.motion.x / GTexGui->scale; 
-            io.cursorPos.y = event.motion.y / GTexGui->scale;
-            
-            io.mouseRelativeMotion.x += event.motion.xrel / GTexGui->scale;
-            io.mouseRelativeMotion.y += event.motion.yrel / GTexGui->scale;
-
-            TGInputLock.unlock();
+            io.submitMouseMotion({event.motion.x / GTexGui->scale, event.motion.y / GTexGui->scale},
+                                 {event.motion.xrel / GTexGui->scale, event.motion.yrel / GTexGui->scale});
             break;
         case SDL_EVENT_TEXT_INPUT:
-            TGInputLock.lock();
-            strcat(io.text, event.text.text);
-            TGInputLock.unlock();
+            io.submitText(event.text.text);
             break;
         default:
             break;
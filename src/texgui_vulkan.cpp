@@ -7,6 +7,7 @@
 #include "util.h"
 
 #include <cassert>
+#include <cstdio>
 #include "vulkan_shaders.hpp"
 #include "msdf-atlas-gen/msdf-atlas-gen.h"
 
@@ -17,6 +18,16 @@
 #undef VMA_IMPLEMENTATION
 #include <vk_mem_alloc.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
 using namespace TexGui;
 using namespace TexGui::Math;
 
@@ -57,6 +68,10 @@ struct TexGui_ImplVulkan_Data
     int currentFrame = 0;
     int imageCount;
     std::vector<std::vector<TGVulkanBuffer>> bufferDestroyQueue;
+    // 0 1 2, 1 2 3 for every quad, shared by all vertex draws
+    TGVulkanBuffer quadIndexBuffer;
+    // texture ids destroyed on each frame, freed once that frame comes round again
+    std::vector<std::vector<uint32_t>> textureDestroyQueue;
 
     VmaAllocator allocator;
 
@@ -64,13 +79,37 @@ struct TexGui_ImplVulkan_Data
 
     //VkDescriptorSet samplerDescriptorSet = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> samplerDescriptorSets;
+    // descriptor sets of destroyed textures, reused by createTexture
+    std::vector<uint32_t> freeTextureIds;
     //VkDescriptorSetLayout samplerDescriptorSetLayout;
     VkDescriptorSetLayout samplerLayout;
     VkBuffer samplerBuffer = 0;
     VmaAllocation samplerBufferAllocation = 0;
 
-    VkPipeline vertPipeline;
+    // One pipeline per RenderDataShading
+    VkPipeline vertPipelines[RD_SHADE_Count];
+    // Same shaders with INSTANCED set, draws RenderData::quads
+    VkPipeline quadPipelines[RD_SHADE_Count] = {};
     VkPipelineLayout vertPipelineLayout = VK_NULL_HANDLE;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    // set if the cache is ours, see VulkanInitInfo::PipelineCachePath
+    std::string pipelineCachePath;
+
+    // Per-draw parameters (set 1) for indirect draws
+    bool indirectDraws = false;
+    uint32_t maxDrawIndirectCount = 1;
+    VkDescriptorSetLayout drawParamsLayout;
+    // reset every frame, the drawParams sets of that frame come from them. A frame that runs out gets another pool,
+    // there is no falling back to direct draws: with indirectDraws set every pipeline reads drawParams.
+    struct FrameDescriptorPools
+    {
+        std::vector<VkDescriptorPool> pools;
+        size_t current = 0;
+    };
+    std::vector<FrameDescriptorPools> frameDescriptorPools;
+    // bound for direct draws, the shaders don't read it then. Zeroed anyway.
+    TGVulkanBuffer emptyDrawParams;
+    VkDescriptorSet emptyDrawParamsSet;
 
     TexGui_ImplVulkan_Data(const VulkanInitInfo& init_info);
 };
@@ -136,20 +175,37 @@ struct VertexPushConstants
     float pxRange;
     Math::fvec2 uvScale;
     uint32_t textBorderColor;
+    // 9-slice insets in texels (left, top, right, bottom), 0 borderScale for plain quads
+    alignas(16) float border[4];
+    float borderScale;
+    // x0, y0, x1, y1 in framebuffer pixels, applied in the shaders instead of a scissor
+    alignas(16) float clip[4];
 } vertPushConstants;
 
 static uint32_t createTexture(VkImageView imageView, VkSampler sampler)
 {
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
 
-    VkDescriptorSet* set = &v->samplerDescriptorSets.emplace_back();
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.pNext                       = VK_NULL_HANDLE;
-    allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool              = v->globalDescriptorPool;
-    allocInfo.descriptorSetCount          = 1;
-    allocInfo.pSetLayouts                 = &v->samplerLayout;
-    VkResult result = vkAllocateDescriptorSets(v->device, &allocInfo, set);
+    uint32_t idx;
+    VkDescriptorSet* set;
+    if (!v->freeTextureIds.empty())
+    {
+        idx = v->freeTextureIds.back();
+        v->freeTextureIds.pop_back();
+        set = &v->samplerDescriptorSets[idx];
+    }
+    else
+    {
+        idx = v->samplerDescriptorSets.size();
+        set = &v->samplerDescriptorSets.emplace_back();
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.pNext                       = VK_NULL_HANDLE;
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool              = v->globalDescriptorPool;
+        allocInfo.descriptorSetCount          = 1;
+        allocInfo.pSetLayouts                 = &v->samplerLayout;
+        VkResult result = vkAllocateDescriptorSets(v->device, &allocInfo, set);
+    }
 
     VkDescriptorImageInfo imgInfo{
         .sampler = sampler,
@@ -170,7 +226,7 @@ static uint32_t createTexture(VkImageView imageView, VkSampler sampler)
     };
     vkUpdateDescriptorSets(v->device, 1, &imageWrite, 0, nullptr);
 
-    return v->samplerDescriptorSets.size() - 1;
+    return idx;
 }
 
 namespace TexGui {
@@ -181,6 +237,7 @@ struct TGVkImage {
 };
 }
 
+// indexed by texture id, empty for textures that don't own their image (customTexture)
 std::vector<TexGui::TGVkImage> images;
 
 static uint32_t _createTexture_Vulkan(void* data, int width, int height, VkSampler sampler)
@@ -307,11 +364,28 @@ static uint32_t _createTexture_Vulkan(void* data, int width, int height, VkSampl
 
     vmaDestroyBuffer(v->allocator, uploadBuffer, allocation);
 
-    images.push_back({image, iv, imageAllocation});
+    if (images.size() <= idx)
+        images.resize(idx + 1);
+    images[idx] = {image, iv, imageAllocation};
 
     return idx;
 }
 
+static void destroyTexture_Vulkan(uint32_t id)
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+    v->textureDestroyQueue[v->currentFrame].push_back(id);
+}
+
+static void destroyImage(TexGui_ImplVulkan_Data* v, uint32_t id)
+{
+    if (id >= images.size() || images[id].image == VK_NULL_HANDLE)
+        return;
+    vkDestroyImageView(v->device, images[id].imageView, nullptr);
+    vmaDestroyImage(v->allocator, images[id].image, images[id].allocation);
+    images[id] = {};
+}
+
 static uint32_t createTexture_Vulkan(void* data, int width, int height)
 {
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
@@ -338,6 +412,12 @@ TexGui_ImplVulkan_Data::TexGui_ImplVulkan_Data(const VulkanInitInfo& init_info)
     renderingInfo = init_info.PipelineRenderingCreateInfo;
     textureSampler = init_info.Sampler;
     imageCount = init_info.ImageCount;
+    GTexGui->instancedQuads = init_info.UseInstancedQuads;
+    GTexGui->compactVertices = init_info.UseCompactVertices;
+    indirectDraws = init_info.UseIndirectDraws;
+    pipelineCache = init_info.PipelineCache;
+    if (!pipelineCache && init_info.PipelineCachePath)
+        pipelineCachePath = init_info.PipelineCachePath;
 }
 
 static void createImmediateCommandBuffers_Vulkan()
@@ -366,12 +446,28 @@ static void createImmediateCommandBuffers_Vulkan()
     vkAllocateCommandBuffers(v->device, &cmdAllocInfo, &v->immCommandBuffer);
 }
 
+// One drawParams set per RenderData per frame
+static VkDescriptorPool createFrameDescriptorPool_Vulkan(TexGui_ImplVulkan_Data* v)
+{
+    VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1024};
+    VkDescriptorPoolCreateInfo framePoolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets = 1024,
+        .poolSizeCount = 1,
+        .pPoolSizes = &poolSize,
+    };
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    vkCreateDescriptorPool(v->device, &framePoolInfo, nullptr, &pool);
+    return pool;
+}
+
 static void initializeDescriptors_Vulkan()
 {
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
     {
         VkDescriptorPoolSize pool_sizes[] = {
             {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 65536},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
         };
         VkDescriptorPoolCreateInfo pool_info = {};
         pool_info.sType                      = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -386,6 +482,7 @@ static void initializeDescriptors_Vulkan()
 
     // probably shouldnt be in descriptors section
     v->bufferDestroyQueue.resize(v->imageCount);
+    v->textureDestroyQueue.resize(v->imageCount);
     VkDescriptorSetLayoutCreateInfo set_info = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
     //all separate descriptor sets
     VkDescriptorSetLayoutBinding bindings[] =
@@ -408,6 +505,57 @@ static void initializeDescriptors_Vulkan()
     set_info.pBindings                       = bindings;
     vkCreateDescriptorSetLayout(v->device, &set_info, nullptr, &v->samplerLayout);
 
+    VkDescriptorSetLayoutBinding drawParamsBinding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+    };
+    VkDescriptorSetLayoutCreateInfo drawParamsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings = &drawParamsBinding,
+    };
+    vkCreateDescriptorSetLayout(v->device, &drawParamsInfo, nullptr, &v->drawParamsLayout);
+
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size               = sizeof(VertexPushConstants);
+        bufferInfo.usage              = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+        VmaAllocationCreateInfo vmaallocInfo = {};
+        vmaallocInfo.requiredFlags           = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        vmaCreateBuffer(v->allocator, &bufferInfo, &vmaallocInfo, &v->emptyDrawParams.buffer, &v->emptyDrawParams.allocation, &v->emptyDrawParams.info);
+        VertexPushConstants zero = {};
+        vmaCopyMemoryToAllocation(v->allocator, &zero, v->emptyDrawParams.allocation, 0, sizeof(zero));
+
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool              = v->globalDescriptorPool;
+        allocInfo.descriptorSetCount          = 1;
+        allocInfo.pSetLayouts                 = &v->drawParamsLayout;
+        vkAllocateDescriptorSets(v->device, &allocInfo, &v->emptyDrawParamsSet);
+
+        VkDescriptorBufferInfo bufInfo = {.buffer = v->emptyDrawParams.buffer, .offset = 0, .range = VK_WHOLE_SIZE};
+        VkWriteDescriptorSet write = {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = v->emptyDrawParamsSet,
+            .dstBinding      = 0,
+            .descriptorCount = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo     = &bufInfo,
+        };
+        vkUpdateDescriptorSets(v->device, 1, &write, 0, nullptr);
+    }
+
+    if (v->indirectDraws)
+    {
+        v->frameDescriptorPools.resize(v->imageCount);
+        for (auto& frame : v->frameDescriptorPools)
+            frame.pools.push_back(createFrameDescriptorPool_Vulkan(v));
+    }
+
     /*
     {
         VkDescriptorSetAllocateInfo allocInfo = {};
@@ -430,6 +578,97 @@ static void createWhiteTexture_Vulkan()
     v->whiteTextureID = createTexture_Vulkan(white, 1, 1);
 }
 
+// Creates the pipeline cache from pipelineCachePath, ignoring the file if it's from another driver or device
+static void createPipelineCache_Vulkan()
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+    if (v->pipelineCachePath.empty()) return;
+
+    std::vector<char> data;
+    if (FILE* f = fopen(v->pipelineCachePath.c_str(), "rb"))
+    {
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        if (size > 0)
+        {
+            data.resize(size);
+            if (fread(data.data(), 1, size, f) != size_t(size)) data.clear();
+        }
+        fclose(f);
+    }
+
+    if (data.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(v->physicalDevice, &properties);
+        VkPipelineCacheHeaderVersionOne header;
+        memcpy(&header, data.data(), sizeof(header));
+        if (header.headerSize < sizeof(header) ||
+            header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            header.vendorID != properties.vendorID ||
+            header.deviceID != properties.deviceID ||
+            memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+            data.clear();
+    }
+    else
+        data.clear();
+
+    VkPipelineCacheCreateInfo cacheInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.empty() ? nullptr : data.data(),
+    };
+    if (vkCreatePipelineCache(v->device, &cacheInfo, nullptr, &v->pipelineCache) != VK_SUCCESS)
+    {
+        v->pipelineCache = VK_NULL_HANDLE;
+        v->pipelineCachePath.clear();
+    }
+}
+
+// Moves `from` over `to`, replacing it if it exists
+static bool replaceFile(const char* from, const char* to)
+{
+#ifdef _WIN32
+    // std::rename fails there when the destination exists
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(from, to) == 0;
+#endif
+}
+
+// Writes our pipeline cache back to pipelineCachePath and destroys it
+static void destroyPipelineCache_Vulkan()
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+    if (v->pipelineCachePath.empty()) return;
+
+    size_t size = 0;
+    std::vector<char> data;
+    if (vkGetPipelineCacheData(v->device, v->pipelineCache, &size, nullptr) == VK_SUCCESS && size > 0)
+    {
+        data.resize(size);
+        if (vkGetPipelineCacheData(v->device, v->pipelineCache, &size, data.data()) != VK_SUCCESS)
+            data.clear();
+    }
+
+    // through a temporary file, so a failed write doesn't leave a truncated cache behind
+    if (!data.empty())
+    {
+        std::string tmpPath = v->pipelineCachePath + ".tmp";
+        if (FILE* f = fopen(tmpPath.c_str(), "wb"))
+        {
+            bool written = fwrite(data.data(), 1, size, f) == size;
+            written = fclose(f) == 0 && written;
+            if (!written || !replaceFile(tmpPath.c_str(), v->pipelineCachePath.c_str()))
+                std::remove(tmpPath.c_str());
+        }
+    }
+
+    vkDestroyPipelineCache(v->device, v->pipelineCache, nullptr);
+    v->pipelineCache = VK_NULL_HANDLE;
+}
+
 static void createPipelines_Vulkan()
 {
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
@@ -440,7 +679,7 @@ static void createPipelines_Vulkan()
         .size = sizeof(VertexPushConstants)
     };
 
-    VkDescriptorSetLayout dsl[] = {v->samplerLayout};
+    VkDescriptorSetLayout dsl[] = {v->samplerLayout, v->drawParamsLayout};
     VkPipelineLayoutCreateInfo layoutInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount         = sizeof(dsl)/sizeof(dsl[0]),
@@ -454,13 +693,37 @@ static void createPipelines_Vulkan()
     std::vector<VkPipelineShaderStageCreateInfo> vertstages;
     VkShaderModule vertvert = createShaderModule(v->device, VK_VERT, sizeof(VK_VERT));
     VkShaderModule vertfrag = createShaderModule(v->device, VK_FRAG, sizeof(VK_FRAG));
+    // INSTANCED, INDIRECT
+    VkBool32 specData[2] = {VK_FALSE, v->indirectDraws};
+    VkSpecializationMapEntry specEntries[2] = {
+        {.constantID = 0, .offset = 0, .size = sizeof(VkBool32)},
+        {.constantID = 1, .offset = sizeof(VkBool32), .size = sizeof(VkBool32)},
+    };
+    VkSpecializationInfo specInfo = {
+        .mapEntryCount = 2,
+        .pMapEntries = specEntries,
+        .dataSize = sizeof(specData),
+        .pData = specData,
+    };
     VkPipelineShaderStageCreateInfo shaderStage = {.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
     shaderStage.pName = "main";
     shaderStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
     shaderStage.module = vertvert;
+    shaderStage.pSpecializationInfo = &specInfo;
     vertstages.push_back(shaderStage);
+    shaderStage.pSpecializationInfo = nullptr;
+    // SHADING, set for each variant
+    int32_t shading = 0;
+    VkSpecializationMapEntry shadingEntry = {.constantID = 0, .offset = 0, .size = sizeof(int32_t)};
+    VkSpecializationInfo shadingInfo = {
+        .mapEntryCount = 1,
+        .pMapEntries = &shadingEntry,
+        .dataSize = sizeof(int32_t),
+        .pData = &shading,
+    };
     shaderStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     shaderStage.module = vertfrag;
+    shaderStage.pSpecializationInfo = &shadingInfo;
     vertstages.push_back(shaderStage);
 
     VkPipelineInputAssemblyStateCreateInfo           inputAssemblyState = {
@@ -534,7 +797,7 @@ static void createPipelines_Vulkan()
     VkVertexInputBindingDescription binding_desc[1] = {};
     binding_desc[0] = {
         .binding = 0,
-        .stride = sizeof(RenderData::Vertex),
+        .stride = GTexGui->compactVertices ? sizeof(RenderData::CompactVertex) : sizeof(RenderData::Vertex),
         .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
     };
 
@@ -559,6 +822,17 @@ static void createPipelines_Vulkan()
         .offset = offsetof(RenderData::Vertex, col),
     };
 
+    // Normalised 16 bit formats are always supported for vertex buffers, unlike SCALED ones,
+    // so the draw scales them back up in the push constants
+    if (GTexGui->compactVertices)
+    {
+        attribute_desc[0].format = VK_FORMAT_R16G16_SNORM;
+        attribute_desc[0].offset = offsetof(RenderData::CompactVertex, pos);
+        attribute_desc[1].format = VK_FORMAT_R16G16_UNORM;
+        attribute_desc[1].offset = offsetof(RenderData::CompactVertex, uv);
+        attribute_desc[2].offset = offsetof(RenderData::CompactVertex, col);
+    }
+
     VkPipelineVertexInputStateCreateInfo             vertexInputState   = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
         .vertexBindingDescriptionCount = sizeof(binding_desc)/sizeof(binding_desc[0]),
@@ -584,9 +858,59 @@ static void createPipelines_Vulkan()
     info.pDynamicState                     = &dynamicStateInfo;
     info.layout                            = v->vertPipelineLayout;
 
-    if (vkCreateGraphicsPipelines(v->device, VK_NULL_HANDLE, 1, &info, nullptr, &v->vertPipeline) != VK_SUCCESS) {
-        printf("Failed to create pipeline\n");
-        assert(false);
+    for (shading = 0; shading < RD_SHADE_Count; shading++)
+    {
+        if (vkCreateGraphicsPipelines(v->device, v->pipelineCache, 1, &info, nullptr, &v->vertPipelines[shading]) != VK_SUCCESS) {
+            printf("Failed to create pipeline\n");
+            assert(false);
+        }
+    }
+
+    if (GTexGui->instancedQuads)
+    {
+        // one RenderData::Quad per instance, the vertex shader makes the corners from gl_VertexIndex
+        VkVertexInputBindingDescription quadBinding = {
+            .binding = 1,
+            .stride = sizeof(RenderData::Quad),
+            .inputRate = VK_VERTEX_INPUT_RATE_INSTANCE,
+        };
+        VkVertexInputAttributeDescription quadAttributes[3] = {};
+        quadAttributes[0] = {
+            .location = 0,
+            .binding = quadBinding.binding,
+            .format = VK_FORMAT_R32G32B32A32_SFLOAT, // pos, size
+            .offset = offsetof(RenderData::Quad, pos),
+        };
+        quadAttributes[1] = {
+            .location = 1,
+            .binding = quadBinding.binding,
+            .format = VK_FORMAT_R16G16B16A16_UNORM,
+            .offset = offsetof(RenderData::Quad, uv),
+        };
+        quadAttributes[2] = {
+            .location = 2,
+            .binding = quadBinding.binding,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .offset = offsetof(RenderData::Quad, col),
+        };
+        VkPipelineVertexInputStateCreateInfo quadInputState = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+            .vertexBindingDescriptionCount = 1,
+            .pVertexBindingDescriptions = &quadBinding,
+            .vertexAttributeDescriptionCount = sizeof(quadAttributes)/sizeof(quadAttributes[0]),
+            .pVertexAttributeDescriptions = quadAttributes,
+        };
+
+        specData[0] = VK_TRUE;
+        info.pVertexInputState = &quadInputState;
+
+        for (shading = 0; shading < RD_SHADE_Count; shading++)
+        {
+            if (vkCreateGraphicsPipelines(v->device, v->pipelineCache, 1, &info, nullptr, &v->quadPipelines[shading]) != VK_SUCCESS) {
+                printf("Failed to create pipeline\n");
+                assert(false);
+            }
+        }
     }
 
     vkDestroyShaderModule(v->device, vertvert, nullptr);
@@ -636,6 +960,74 @@ void VulkanContext::createOrResizeBuffer(VkBuffer& buffer, VkDeviceMemory& buffe
 }
 */
 
+// Quads per vertex draw, so every index fits in 16 bits
+constexpr uint32_t MAX_INDEXED_QUADS = 65536 / 4;
+
+// Fills a GPU only index buffer with the indices of MAX_INDEXED_QUADS quads
+static void createQuadIndexBuffer_Vulkan()
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+    VkDeviceSize size = MAX_INDEXED_QUADS * 6 * sizeof(uint16_t);
+
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.pNext              = nullptr;
+    bufferInfo.size               = size;
+    bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo vmaallocInfo = {};
+    vmaallocInfo.requiredFlags           = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    vmaallocInfo.flags                   = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    TGVulkanBuffer uploadBuffer;
+    vmaCreateBuffer(v->allocator, &bufferInfo, &vmaallocInfo, &uploadBuffer.buffer, &uploadBuffer.allocation, &uploadBuffer.info);
+
+    uint16_t* indices = (uint16_t*)uploadBuffer.info.pMappedData;
+    for (uint32_t i = 0; i < MAX_INDEXED_QUADS; i++)
+    {
+        uint16_t idx = i * 4;
+        indices[i * 6 + 0] = idx;
+        indices[i * 6 + 1] = idx + 1;
+        indices[i * 6 + 2] = idx + 2;
+        indices[i * 6 + 3] = idx + 1;
+        indices[i * 6 + 4] = idx + 2;
+        indices[i * 6 + 5] = idx + 3;
+    }
+
+    bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VmaAllocationCreateInfo allocinfo = {};
+    allocinfo.usage                   = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocinfo.requiredFlags           = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    vmaCreateBuffer(v->allocator, &bufferInfo, &allocinfo, &v->quadIndexBuffer.buffer, &v->quadIndexBuffer.allocation, &v->quadIndexBuffer.info);
+
+    vkResetFences(v->device, 1, &v->immCommandFence);
+    vkResetCommandBuffer(v->immCommandBuffer, 0);
+    VkCommandBufferBeginInfo cmdBeginInfo = {};
+    cmdBeginInfo.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBeginInfo.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(v->immCommandBuffer, &cmdBeginInfo);
+
+    VkBufferCopy copyRegion = {.srcOffset = 0, .dstOffset = 0, .size = size};
+    vkCmdCopyBuffer(v->immCommandBuffer, uploadBuffer.buffer, v->quadIndexBuffer.buffer, 1, &copyRegion);
+    buffer_barrier(v->immCommandBuffer, v->quadIndexBuffer.buffer, 0, size,
+            VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT);
+
+    vkEndCommandBuffer(v->immCommandBuffer);
+    VkCommandBufferSubmitInfo cmdinfo{};
+    cmdinfo.sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cmdinfo.commandBuffer = v->immCommandBuffer;
+
+    VkSubmitInfo2 submit            = {};
+    submit.sType                    = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    submit.commandBufferInfoCount   = 1;
+    submit.pCommandBufferInfos      = &cmdinfo;
+    vkQueueSubmit2(v->graphicsQueue, 1, &submit, v->immCommandFence);
+    vkWaitForFences(v->device, 1, &v->immCommandFence, true, 9999999999);
+
+    vmaDestroyBuffer(v->allocator, uploadBuffer.buffer, uploadBuffer.allocation);
+}
+
 static void framebufferSizeCallback_Vulkan(int width, int height)
 {
 }
@@ -651,18 +1043,354 @@ static void cmdResetScissor(VkCommandBuffer cmd)
 }
 
 std::vector<VkRect2D> scissorStack;
+std::vector<RenderData::DrawRef> drawOrder;
+
+static bool isDrawCommand(const RenderData::Command& c)
+{
+    return c.type == RD_CMD_Draw || c.type == RD_CMD_DrawQuads || c.type == RD_CMD_DrawSlices;
+}
+
+// Adds the draws after drawOrder[i] that can go in the same call as it, returns the number of quads
+static uint32_t mergeDraws(const RenderData& data, size_t& i)
+{
+    const auto& c = data.commands[drawOrder[i].command];
+    uint32_t count = c.draw.count;
+    while (i + 1 < drawOrder.size() && RenderData::canMerge(c, data.commands[drawOrder[i + 1].command]))
+        count += data.commands[drawOrder[++i].command].draw.count;
+    return count;
+}
+
+static void cmdScissor(VkCommandBuffer cmd, const RenderData::Command& c)
+{
+    if (c.scissor.push)
+    {
+        auto& scissor = scissorStack.emplace_back();
+        scissor.offset.x      = fmax(0, c.scissor.x);
+        scissor.offset.y      = fmax(0, c.scissor.y);
+        scissor.extent.width  = fmax(0, c.scissor.width);
+        scissor.extent.height = fmax(0, c.scissor.height);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+    }
+    else
+    {
+        if (scissorStack.size() > 0)
+            scissorStack.pop_back();
+        if (scissorStack.size() > 0)
+            vkCmdSetScissor(cmd, 0, 1, &scissorStack.back());
+        else
+        {
+            cmdResetScissor(cmd);
+        }
+    }
+}
+
+static void setDrawParams(VertexPushConstants& params, const RenderData::Command& c, const RenderData& data)
+{
+    params.textureIndex = c.draw.textureIndex;
+    params.scale = {c.draw.scaleX, c.draw.scaleY};
+    params.translate = {c.draw.translateX, c.draw.translateY};
+    params.pxRange = c.draw.pxRange;
+    params.textBorderColor = c.draw.outlineColor;
+    params.uvScale = {c.draw.uvScaleX, c.draw.uvScaleY};
+    if (GTexGui->compactVertices && c.type == RD_CMD_Draw)
+    {
+        // undo the SNORM/UNORM normalisation and the fixed point steps
+        float posScale = 32767.f / TEXGUI_VERTEX_SUBPIXEL;
+        float uvScale = 65535.f / TEXGUI_VERTEX_SUBPIXEL;
+        params.scale = {c.draw.scaleX * posScale, c.draw.scaleY * posScale};
+        params.uvScale = {c.draw.uvScaleX * uvScale, c.draw.uvScaleY * uvScale};
+    }
+    if (c.type == RD_CMD_DrawSlices)
+    {
+        memcpy(params.border, c.draw.border, sizeof(params.border));
+        params.borderScale = c.draw.borderScale;
+    }
+    else
+        params.borderScale = 0;
+    if (c.draw.clipIndex > 0)
+    {
+        const fbox& clip = data.clipRects[c.draw.clipIndex - 1];
+        params.clip[0] = clip.pos.x;
+        params.clip[1] = clip.pos.y;
+        params.clip[2] = clip.pos.x + clip.size.width;
+        params.clip[3] = clip.pos.y + clip.size.height;
+    }
+    else
+    {
+        params.clip[0] = params.clip[1] = -FLT_MAX;
+        params.clip[2] = params.clip[3] = FLT_MAX;
+    }
+}
+
+// One push constant update and draw per merged draw
+static void drawDirect_Vulkan(VkCommandBuffer cmd, const RenderData& data)
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipelineLayout, 1, 1, &v->emptyDrawParamsSet, 0, nullptr);
+
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    uint32_t currVertexQuad = 0;
+    uint32_t currQuad = 0;
+    for (size_t i = 0; i < drawOrder.size(); i++)
+    {
+        const auto& c = data.commands[drawOrder[i].command];
+        if (c.type == RD_CMD_Scissor)
+        {
+            cmdScissor(cmd, c);
+            continue;
+        }
+        if (!isDrawCommand(c)) continue;
+
+        // adjacent draws with the same state go in one call
+        uint32_t count = mergeDraws(data, i);
+
+        VkPipeline pipeline = c.type == RD_CMD_Draw ? v->vertPipelines[c.draw.shading] : v->quadPipelines[c.draw.shading];
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipelineLayout, 0, 1, &v->samplerDescriptorSets[c.draw.textureIndex], 0, nullptr);
+
+        setDrawParams(vertPushConstants, c, data);
+        //size_t pushSz = c.textBorderColor.a > 0 ? sizeof(vertPushConstants) : sizeof(vertPushConstants) - sizeof(vertPushConstants.textBorderColor);
+        vkCmdPushConstants(cmd, v->vertPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants), &vertPushConstants);
+
+        if (c.type != RD_CMD_Draw)
+        {
+            // 9 quads of 6 vertices for slices
+            vkCmdDraw(cmd, c.type == RD_CMD_DrawSlices ? 54 : 6, count, 0, currQuad);
+            currQuad += count;
+        }
+        else
+        {
+            // the index buffer only reaches MAX_INDEXED_QUADS, so offset the vertices instead
+            for (uint32_t q = 0; q < count; q += MAX_INDEXED_QUADS)
+            {
+                uint32_t n = std::min(count - q, MAX_INDEXED_QUADS);
+                vkCmdDrawIndexed(cmd, 6 * n, 1, 0, int32_t(4 * (currVertexQuad + q)), 0);
+            }
+            currVertexQuad += count;
+        }
+    }
+}
+
+// Host visible buffer destroyed with the frame
+static TGVulkanBuffer createFrameBuffer(TexGui_ImplVulkan_Data* v, const void* data, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    VkBufferCreateInfo bufferCreateInfo = {};
+    bufferCreateInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCreateInfo.size               = size;
+    bufferCreateInfo.usage              = usage;
+
+    VmaAllocationCreateInfo vmaallocInfo = {};
+    vmaallocInfo.requiredFlags           = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    vmaallocInfo.flags                   = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    TGVulkanBuffer buffer;
+    vmaCreateBuffer(v->allocator, &bufferCreateInfo, &vmaallocInfo, &buffer.buffer, &buffer.allocation, &buffer.info);
+    v->bufferDestroyQueue[v->currentFrame].push_back(buffer);
+    vmaCopyMemoryToAllocation(v->allocator, data, buffer.allocation, 0, size);
+    return buffer;
+}
+
+// Scratch for drawIndirect_Vulkan, kept between frames
+std::vector<VertexPushConstants> drawParams;
+std::vector<VkDrawIndexedIndirectCommand> vertexDrawCommands;
+std::vector<VkDrawIndirectCommand> quadDrawCommands;
+// Draws with the same pipeline (type and shading) and texture go in one indirect call, scissor commands are kept in between
+struct IndirectRun
+{
+    uint32_t command; // the first draw, or a scissor command
+    uint32_t first; // into vertexDrawCommands or quadDrawCommands
+    uint32_t count;
+};
+std::vector<IndirectRun> indirectRuns;
+
+// Must match INDIRECT_VERTEX_STRIDE in vulkan.vert
+constexpr uint32_t INDIRECT_VERTEX_STRIDE = 64;
+
+// From the current frame's pools, adding one when they are full. VK_NULL_HANDLE if that fails too.
+static VkDescriptorSet allocateDrawParamsSet_Vulkan(TexGui_ImplVulkan_Data* v)
+{
+    auto& frame = v->frameDescriptorPools[v->currentFrame];
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType                       = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount          = 1;
+    allocInfo.pSetLayouts                 = &v->drawParamsLayout;
+    for (; ; frame.current++)
+    {
+        bool added = frame.current == frame.pools.size();
+        if (added)
+        {
+            VkDescriptorPool pool = createFrameDescriptorPool_Vulkan(v);
+            if (pool == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+            frame.pools.push_back(pool);
+        }
+
+        VkDescriptorSet set;
+        allocInfo.descriptorPool = frame.pools[frame.current];
+        if (vkAllocateDescriptorSets(v->device, &allocInfo, &set) == VK_SUCCESS)
+            return set;
+        if (added) return VK_NULL_HANDLE;
+    }
+}
+
+// The parameters of each merged draw go in a storage buffer, read with the draw index the shader gets from
+// firstInstance (vertices) or firstVertex (instances).
+static void drawIndirect_Vulkan(VkCommandBuffer cmd, const RenderData& data)
+{
+    TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
+
+    drawParams.clear();
+    vertexDrawCommands.clear();
+    quadDrawCommands.clear();
+    indirectRuns.clear();
+
+    uint32_t currVertexQuad = 0;
+    uint32_t currQuad = 0;
+    for (size_t i = 0; i < drawOrder.size(); i++)
+    {
+        uint32_t command = drawOrder[i].command;
+        const auto& c = data.commands[command];
+        if (!isDrawCommand(c))
+        {
+            if (c.type == RD_CMD_Scissor)
+                indirectRuns.push_back({command, 0, 0});
+            continue;
+        }
+
+        uint32_t count = mergeDraws(data, i);
+        uint32_t drawIndex = drawParams.size();
+        setDrawParams(drawParams.emplace_back(vertPushConstants), c, data);
+
+        bool indexed = c.type == RD_CMD_Draw;
+        IndirectRun* run = indirectRuns.empty() ? nullptr : &indirectRuns.back();
+        if (run)
+        {
+            const auto& rc = data.commands[run->command];
+            if (!isDrawCommand(rc) || (rc.type == RD_CMD_Draw) != indexed ||
+                rc.draw.shading != c.draw.shading || rc.draw.textureIndex != c.draw.textureIndex)
+                run = nullptr;
+        }
+        if (!run)
+            run = &indirectRuns.emplace_back(IndirectRun{command, uint32_t(indexed ? vertexDrawCommands.size() : quadDrawCommands.size()), 0});
+
+        if (indexed)
+        {
+            // the index buffer only reaches MAX_INDEXED_QUADS, so offset the vertices instead
+            for (uint32_t q = 0; q < count; q += MAX_INDEXED_QUADS)
+            {
+                uint32_t n = std::min(count - q, MAX_INDEXED_QUADS);
+                vertexDrawCommands.push_back({
+                    .indexCount = 6 * n,
+                    .instanceCount = 1,
+                    .firstIndex = 0,
+                    .vertexOffset = int32_t(4 * (currVertexQuad + q)),
+                    .firstInstance = drawIndex,
+                });
+                run->count++;
+            }
+            currVertexQuad += count;
+        }
+        else
+        {
+            // 9 quads of 6 vertices for slices
+            quadDrawCommands.push_back({
+                .vertexCount = c.type == RD_CMD_DrawSlices ? 54u : 6u,
+                .instanceCount = count,
+                .firstVertex = drawIndex * INDIRECT_VERTEX_STRIDE,
+                .firstInstance = currQuad,
+            });
+            run->count++;
+            currQuad += count;
+        }
+    }
+
+    if (drawParams.empty())
+    {
+        for (const auto& run : indirectRuns)
+            cmdScissor(cmd, data.commands[run.command]);
+        return;
+    }
+
+    // Out of device memory: the pipelines all read drawParams, so there is nothing to draw with
+    VkDescriptorSet paramsSet = allocateDrawParamsSet_Vulkan(v);
+    if (paramsSet == VK_NULL_HANDLE)
+        return;
+
+    TGVulkanBuffer paramsBuffer = createFrameBuffer(v, drawParams.data(), drawParams.size() * sizeof(VertexPushConstants), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    VkDescriptorBufferInfo bufInfo = {.buffer = paramsBuffer.buffer, .offset = 0, .range = VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write = {
+        .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet          = paramsSet,
+        .dstBinding      = 0,
+        .descriptorCount = 1,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo     = &bufInfo,
+    };
+    vkUpdateDescriptorSets(v->device, 1, &write, 0, nullptr);
+
+    TGVulkanBuffer vertexCommandBuffer = {};
+    if (!vertexDrawCommands.empty())
+        vertexCommandBuffer = createFrameBuffer(v, vertexDrawCommands.data(), vertexDrawCommands.size() * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    TGVulkanBuffer quadCommandBuffer = {};
+    if (!quadDrawCommands.empty())
+        quadCommandBuffer = createFrameBuffer(v, quadDrawCommands.data(), quadDrawCommands.size() * sizeof(VkDrawIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipelineLayout, 1, 1, &paramsSet, 0, nullptr);
+    // not read by the shaders, but they still have to be set
+    vkCmdPushConstants(cmd, v->vertPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants), &vertPushConstants);
+
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    for (const auto& run : indirectRuns)
+    {
+        const auto& c = data.commands[run.command];
+        if (!isDrawCommand(c))
+        {
+            cmdScissor(cmd, c);
+            continue;
+        }
+
+        bool indexed = c.type == RD_CMD_Draw;
+        VkPipeline pipeline = indexed ? v->vertPipelines[c.draw.shading] : v->quadPipelines[c.draw.shading];
+        if (pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            boundPipeline = pipeline;
+        }
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipelineLayout, 0, 1, &v->samplerDescriptorSets[c.draw.textureIndex], 0, nullptr);
+
+        for (uint32_t d = 0; d < run.count; d += v->maxDrawIndirectCount)
+        {
+            uint32_t n = std::min(run.count - d, v->maxDrawIndirectCount);
+            if (indexed)
+                vkCmdDrawIndexedIndirect(cmd, vertexCommandBuffer.buffer, (run.first + d) * sizeof(VkDrawIndexedIndirectCommand), n, sizeof(VkDrawIndexedIndirectCommand));
+            else
+                vkCmdDrawIndirect(cmd, quadCommandBuffer.buffer, (run.first + d) * sizeof(VkDrawIndirectCommand), n, sizeof(VkDrawIndirectCommand));
+        }
+    }
+}
+
 static void _renderFromRenderData_Vulkan(VkCommandBuffer cmd, const RenderData& data)
 {
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
 
+    // the geometry is written in draw order, so that the draws sortDraws put together are contiguous
+    data.sortDraws(drawOrder);
+
     // allocate vertices buffer
-    if (data.vertices.size() > 0)
+    bool compact = GTexGui->compactVertices;
+    const char* vertexData = compact ? (const char*)data.compactVertices.data() : (const char*)data.vertices.data();
+    size_t quadVerticesSize = 4 * (compact ? sizeof(RenderData::CompactVertex) : sizeof(RenderData::Vertex));
+    size_t vertexDataSize = (compact ? data.compactVertices.size() : data.vertices.size()) / 4 * quadVerticesSize;
+    if (vertexDataSize > 0)
     {
-        assert(data.indices.size() > 0);
         VkBufferCreateInfo bufferCreateInfo = {};
         bufferCreateInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferCreateInfo.pNext              = nullptr;
-        bufferCreateInfo.size               = sizeof(RenderData::Vertex) * data.vertices.size();
+        bufferCreateInfo.size               = vertexDataSize;
         bufferCreateInfo.usage              = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 
         VmaAllocationCreateInfo vmaallocInfo = {};
@@ -675,87 +1403,71 @@ static void _renderFromRenderData_Vulkan(VkCommandBuffer cmd, const RenderData&
 
         v->bufferDestroyQueue[v->currentFrame].push_back(vertexBuffer);
 
-        vmaCopyMemoryToAllocation(v->allocator, data.vertices.data(), vertexBuffer.allocation, 0, data.vertices.size() * sizeof(RenderData::Vertex));
+        char* dst = (char*)allocationInfo.pMappedData;
+        for (const auto& ref : drawOrder)
+        {
+            const auto& c = data.commands[ref.command];
+            if (c.type != RD_CMD_Draw) continue;
+            memcpy(dst, vertexData + ref.first * quadVerticesSize, c.draw.count * quadVerticesSize);
+            dst += c.draw.count * quadVerticesSize;
+        }
+        vmaFlushAllocation(v->allocator, vertexBuffer.allocation, 0, VK_WHOLE_SIZE);
 
         VkDeviceSize vertexOffset = 0;
         vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer.buffer, &vertexOffset);
+        vkCmdBindIndexBuffer(cmd, v->quadIndexBuffer.buffer, 0, VK_INDEX_TYPE_UINT16);
+    }
 
-        bufferCreateInfo.size = sizeof(uint32_t) * data.indices.size();
-        bufferCreateInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-
-        TGVulkanBuffer indexBuffer;
-        vmaCreateBuffer(v->allocator, &bufferCreateInfo, &vmaallocInfo, &indexBuffer.buffer, &indexBuffer.allocation, &allocationInfo);
-        vmaCopyMemoryToAllocation(v->allocator, data.indices.data(), indexBuffer.allocation, 0, data.indices.size() * sizeof(uint32_t));
+    if (data.quads.size() > 0)
+    {
+        VkBufferCreateInfo bufferCreateInfo = {};
+        bufferCreateInfo.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.pNext              = nullptr;
+        bufferCreateInfo.size               = sizeof(RenderData::Quad) * data.quads.size();
+        bufferCreateInfo.usage              = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
 
-        v->bufferDestroyQueue[v->currentFrame].push_back(indexBuffer);
+        VmaAllocationCreateInfo vmaallocInfo = {};
+        vmaallocInfo.requiredFlags           = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        vmaallocInfo.flags                   = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
-        vkCmdBindIndexBuffer(cmd, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-    }
+        VmaAllocationInfo allocationInfo;
+        TGVulkanBuffer quadBuffer;
+        vmaCreateBuffer(v->allocator, &bufferCreateInfo, &vmaallocInfo, &quadBuffer.buffer, &quadBuffer.allocation, &allocationInfo);
 
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipeline);
+        v->bufferDestroyQueue[v->currentFrame].push_back(quadBuffer);
 
-    int count = 0;
-    int currIndex = 0;
-    for (auto& c : data.commands)
-    {
-        switch (c.type)
+        RenderData::Quad* dst = (RenderData::Quad*)allocationInfo.pMappedData;
+        for (const auto& ref : drawOrder)
         {
-            case RD_CMD_Scissor:
-                if (c.scissor.push)
-                {
-                    auto scissor = scissorStack.emplace_back();
-                    scissor.offset.x      = fmax(0, c.scissor.x);
-                    scissor.offset.y      = fmax(0, c.scissor.y);
-                    scissor.extent.width  = fmax(0, c.scissor.width);
-                    scissor.extent.height = fmax(0, c.scissor.height);
-                    vkCmdSetScissor(cmd, 0, 1, &scissor);
-                }
-                else
-                {
-                    if (scissorStack.size() > 0)
-                        scissorStack.pop_back();
-                    if (scissorStack.size() > 0)
-                        vkCmdSetScissor(cmd, 0, 1, &scissorStack.back());
-                    else
-                    {
-                        cmdResetScissor(cmd);
-                    }
-                }
-                break;
-            case RD_CMD_Draw:
-                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, v->vertPipelineLayout, 0, 1, &v->samplerDescriptorSets[c.draw.textureIndex], 0, nullptr);
-
-                vertPushConstants.textureIndex = c.draw.textureIndex;
-                vertPushConstants.scale = {c.draw.scaleX, c.draw.scaleY};
-                vertPushConstants.translate = {c.draw.translateX, c.draw.translateY};
-                vertPushConstants.pxRange = 0;
-                vertPushConstants.uvScale = {c.draw.uvScaleX, c.draw.uvScaleY};
-                //size_t pushSz = c.textBorderColor.a > 0 ? sizeof(vertPushConstants) : sizeof(vertPushConstants) - sizeof(vertPushConstants.textBorderColor);
-                vkCmdPushConstants(cmd, v->vertPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexPushConstants), &vertPushConstants);
-
-                vkCmdDrawIndexed(cmd, c.draw.indexCount, 1, currIndex, 0, 0);
-
-                //#TODO: have firstIndex in the command itself maybe
-                currIndex += c.draw.indexCount;
-                break;
-            default:
-                break;
+            const auto& c = data.commands[ref.command];
+            if (c.type != RD_CMD_DrawQuads && c.type != RD_CMD_DrawSlices) continue;
+            memcpy(dst, &data.quads[ref.first], c.draw.count * sizeof(RenderData::Quad));
+            dst += c.draw.count;
         }
+        vmaFlushAllocation(v->allocator, quadBuffer.allocation, 0, VK_WHOLE_SIZE);
+
+        VkDeviceSize quadOffset = 0;
+        vkCmdBindVertexBuffers(cmd, 1, 1, &quadBuffer.buffer, &quadOffset);
     }
 
-    std::vector<RenderData> children(data.children);
+    if (v->indirectDraws)
+        drawIndirect_Vulkan(cmd, data);
+    else
+        drawDirect_Vulkan(cmd, data);
+
+    std::vector<RenderData*> children(data.children);
 
     if (data.ordered)
     {
-        std::sort(children.begin(), children.end(), [](const RenderData& lhs, const RenderData& rhs)
+        std::sort(children.begin(), children.end(), [](const RenderData* lhs, const RenderData* rhs)
                 {
-                    return lhs.priority < rhs.priority;
+                    return lhs->priority < rhs->priority;
                 }
                 );
     }
 
-    for (const auto& child : children)
-        renderFromRenderData_Vulkan(cmd, child);
+    for (const auto* child : children)
+        renderFromRenderData_Vulkan(cmd, *child);
 
     children.clear();
 }
@@ -781,6 +1493,22 @@ static void newFrame_Vulkan()
     }
 
     dq.clear();
+
+    if (v->indirectDraws)
+    {
+        auto& frame = v->frameDescriptorPools[v->currentFrame];
+        for (VkDescriptorPool pool : frame.pools)
+            vkResetDescriptorPool(v->device, pool, 0);
+        frame.current = 0;
+    }
+
+    auto& tq = v->textureDestroyQueue[v->currentFrame];
+    for (uint32_t id : tq)
+    {
+        destroyImage(v, id);
+        v->freeTextureIds.push_back(id);
+    }
+    tq.clear();
 }
 
 void renderClean_Vulkan()
@@ -793,10 +1521,21 @@ void renderClean_Vulkan()
 
     vkDestroySampler(v->device, v->linearSampler, nullptr);
 
-    vkDestroyPipeline(v->device, v->vertPipeline, nullptr);
+    for (VkPipeline pipeline : v->vertPipelines)
+        vkDestroyPipeline(v->device, pipeline, nullptr);
+    vmaDestroyBuffer(v->allocator, v->quadIndexBuffer.buffer, v->quadIndexBuffer.allocation);
+    for (VkPipeline pipeline : v->quadPipelines)
+        if (pipeline != VK_NULL_HANDLE)
+            vkDestroyPipeline(v->device, pipeline, nullptr);
     vkDestroyPipelineLayout(v->device, v->vertPipelineLayout, nullptr);
+    destroyPipelineCache_Vulkan();
 
     vkDestroyDescriptorSetLayout(v->device, v->samplerLayout, nullptr);
+    vkDestroyDescriptorSetLayout(v->device, v->drawParamsLayout, nullptr);
+    for (auto& frame : v->frameDescriptorPools)
+        for (VkDescriptorPool pool : frame.pools)
+            vkDestroyDescriptorPool(v->device, pool, nullptr);
+    vmaDestroyBuffer(v->allocator, v->emptyDrawParams.buffer, v->emptyDrawParams.allocation);
 
     for (auto& dq : v->bufferDestroyQueue)
     {
@@ -804,11 +1543,8 @@ void renderClean_Vulkan()
             vmaDestroyBuffer(v->allocator, it->buffer, it->allocation);
         }
     }
-    for (auto& im : images)
-    {
-        vmaDestroyImage(v->allocator, im.image, im.allocation);
-        vkDestroyImageView(v->device, im.imageView, nullptr);
-    }
+    for (uint32_t id = 0; id < images.size(); id++)
+        destroyImage(v, id);
     //#TODO: need to destroy all textures here
 }
 
@@ -822,6 +1558,7 @@ bool TexGui::initVulkan(VulkanInitInfo& info)
     GTexGui->rendererFns.renderClean = renderClean_Vulkan;
     GTexGui->rendererFns.framebufferSizeCallback = framebufferSizeCallback_Vulkan;
     GTexGui->rendererFns.newFrame = newFrame_Vulkan;
+    GTexGui->rendererFns.destroyTexture = destroyTexture_Vulkan;
 
     TexGui_ImplVulkan_Data* v = (TexGui_ImplVulkan_Data*)(GTexGui->rendererData);
     VkSamplerCreateInfo sampl = {.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
@@ -829,9 +1566,21 @@ bool TexGui::initVulkan(VulkanInitInfo& info)
     sampl.minFilter           = VK_FILTER_LINEAR;
     vkCreateSampler(v->device, &sampl, nullptr, &v->linearSampler);
 
+    if (v->indirectDraws)
+    {
+        VkPhysicalDeviceFeatures features;
+        vkGetPhysicalDeviceFeatures(v->physicalDevice, &features);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(v->physicalDevice, &properties);
+        v->indirectDraws = features.multiDrawIndirect && features.drawIndirectFirstInstance;
+        v->maxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+    }
+
     createImmediateCommandBuffers_Vulkan();
     initializeDescriptors_Vulkan();
+    createPipelineCache_Vulkan();
     createPipelines_Vulkan();
+    createQuadIndexBuffer_Vulkan();
     createWhiteTexture_Vulkan();
     //#TODO: need to delete more stuff probably
     return true;
@@ -1,4 +1,7 @@
 #version 450 core
+// RenderDataShading of the draws the pipeline is for: 0 flat colour, 1 textured, 2 MSDF text, 3 MSDF text with an outline
+layout(constant_id = 0) const int SHADING = 1;
+
 layout(location = 0) out vec4 fColor;
 layout(location = 0) in struct {
     vec4 Color;
@@ -7,6 +10,7 @@ layout(location = 0) in struct {
 layout(location = 2) flat in uint texID;
 layout(location = 3) flat in float pxRange;
 layout(location = 4) flat in vec4 textBorderColor;
+layout(location = 5) flat in vec4 clipRect;
 
 layout(set = 0, binding = 0) uniform sampler2D tex;
 
@@ -16,9 +20,19 @@ float median(float r, float g, float b) {
 
 void main()
 {
+    // Lines aren't cut to the clip rect, quads and slices already are
+    if (any(lessThan(gl_FragCoord.xy, clipRect.xy)) || any(greaterThanEqual(gl_FragCoord.xy, clipRect.zw)))
+        discard;
+
+    if (SHADING == 0)
+    {
+        fColor = In.Color.abgr;
+        return;
+    }
+
     fColor = texture(tex, In.UV.st);
 
-    if (pxRange > 0.9)
+    if (SHADING >= 2)
     {
         float sd = median(fColor.r, fColor.g, fColor.b);
         float screenPxDistance = pxRange * (sd - 0.5);
@@ -26,7 +40,7 @@ void main()
         fColor.rgb = vec3(1.0);
 
         float neg = fColor.a - 0.5;
-        if (neg < 0 && textBorderColor.a > 0.01)
+        if (SHADING == 3 && neg < 0)
         {
             opacity += smoothstep(fColor.a, 0.0, 0.01) * textBorderColor.a;
             fColor.rgb = textBorderColor.rgb;
@@ -1,30 +1,107 @@
 #version 450 core
-layout(location = 0) in vec2 aPos;
-layout(location = 1) in vec2 aUV;
+// Set for the quad pipeline: one RenderData::Quad per instance instead of one vertex per vertex
+layout(constant_id = 0) const bool INSTANCED = false;
+// Set when drawing with vkCmdDraw*Indirect: the parameters come from drawParams instead of the push constants,
+// indexed by gl_InstanceIndex for vertices and by gl_VertexIndex / INDIRECT_VERTEX_STRIDE for instances
+layout(constant_id = 1) const bool INDIRECT = false;
+#define INDIRECT_VERTEX_STRIDE 64
+
+// Vertices: xy is the position, uv in texels
+// Instances: pos, size and the uv rect normalised to 0-1
+layout(location = 0) in vec4 aPos;
+layout(location = 1) in vec4 aUV;
 layout(location = 2) in vec4 aColor;
 
-layout( push_constant ) uniform constants
-{	
+struct DrawParams
+{
     vec2 scale;
     vec2 translate;
     uint texID;
     float pxRange;
     vec2 uvScale;
     uint textBorderColor;
+    vec4 border; // 9-slice insets in texels: left, top, right, bottom
+    float borderScale; // 0 unless drawing slices
+    vec4 clip; // x0, y0, x1, y1 in framebuffer pixels
+};
+
+layout( push_constant ) uniform constants
+{
+    DrawParams params;
 } pushConstants;
 
+layout(std430, set = 1, binding = 0) readonly buffer DrawParamsBuffer
+{
+    DrawParams drawParams[];
+};
+
 out gl_PerVertex { vec4 gl_Position; };
 layout(location = 0) out struct { vec4 Color; vec2 UV; } Out;
 layout(location = 2) flat out uint texID;
 layout(location = 3) flat out float pxRange;
 layout(location = 4) flat out vec4 textBorderColor;
+layout(location = 5) flat out vec4 clipRect;
+
+// same winding as the indices RenderData::pushQuad writes
+const vec2 corners[6] = vec2[](vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 0), vec2(0, 1), vec2(1, 1));
+
+// Edge i (0-3) of a 9-slice grid between a and b, with insets lo and hi
+float sliceEdge(float a, float b, float lo, float hi, int i)
+{
+    return i == 0 ? a : i == 1 ? a + lo : i == 2 ? b - hi : b;
+}
 
 void main()
 {
+    DrawParams p = pushConstants.params;
+    int vertex = gl_VertexIndex;
+    if (INDIRECT)
+    {
+        p = drawParams[INSTANCED ? gl_VertexIndex / INDIRECT_VERTEX_STRIDE : gl_InstanceIndex];
+        vertex = INSTANCED ? gl_VertexIndex % INDIRECT_VERTEX_STRIDE : gl_VertexIndex;
+    }
+
+    vec2 pos;
+    if (INSTANCED && p.borderScale > 0)
+    {
+        // 54 vertices, 6 per slice, row-major
+        int slice = vertex / 6;
+        vec2 corner = corners[vertex % 6];
+        ivec2 e0 = ivec2(slice % 3, slice / 3);
+        ivec2 e1 = e0 + 1;
+
+        vec4 inset = p.border * p.borderScale;
+        vec4 uvInset = p.border * p.uvScale.xyxy;
+        vec2 end = aPos.xy + aPos.zw;
+        vec2 p0 = vec2(sliceEdge(aPos.x, end.x, inset.x, inset.z, e0.x), sliceEdge(aPos.y, end.y, inset.y, inset.w, e0.y));
+        vec2 p1 = vec2(sliceEdge(aPos.x, end.x, inset.x, inset.z, e1.x), sliceEdge(aPos.y, end.y, inset.y, inset.w, e1.y));
+        vec2 uv0 = vec2(sliceEdge(aUV.x, aUV.z, uvInset.x, uvInset.z, e0.x), sliceEdge(aUV.y, aUV.w, uvInset.y, uvInset.w, e0.y));
+        vec2 uv1 = vec2(sliceEdge(aUV.x, aUV.z, uvInset.x, uvInset.z, e1.x), sliceEdge(aUV.y, aUV.w, uvInset.y, uvInset.w, e1.y));
+
+        // cut the slice to the clip rect, moving the uvs with it
+        vec2 span = p1 - p0;
+        vec2 invSpan = vec2(span.x != 0 ? 1 / span.x : 0, span.y != 0 ? 1 / span.y : 0);
+        vec2 c0 = clamp(p0, p.clip.xy, p.clip.zw);
+        vec2 c1 = clamp(p1, p.clip.xy, p.clip.zw);
+        pos = mix(c0, c1, corner);
+        Out.UV = mix(mix(uv0, uv1, (c0 - p0) * invSpan), mix(uv0, uv1, (c1 - p0) * invSpan), corner);
+    }
+    else if (INSTANCED)
+    {
+        vec2 corner = corners[vertex];
+        pos = aPos.xy + corner * aPos.zw;
+        Out.UV = mix(aUV.xy, aUV.zw, corner);
+    }
+    else
+    {
+        pos = aPos.xy;
+        Out.UV = aUV.xy * p.uvScale;
+    }
+
     Out.Color = aColor;
-    Out.UV = aUV * pushConstants.uvScale;
-    texID = pushConstants.texID;
-    pxRange = pushConstants.pxRange;
-    textBorderColor = unpackUnorm4x8(pushConstants.textBorderColor).abgr;
-    gl_Position = vec4(aPos * pushConstants.scale + pushConstants.translate, 0, 1);
+    texID = p.texID;
+    pxRange = p.pxRange;
+    textBorderColor = unpackUnorm4x8(p.textBorderColor).abgr;
+    clipRect = p.clip;
+    gl_Position = vec4(pos * p.scale + p.translate, 0, 1);
 }